@@ -8,6 +8,7 @@
 #
 
 import bpy
+import mathutils
 import sys
 import os
 import numpy as np
@@ -16,19 +17,95 @@ import json
 import struct
 import bmesh
 import json
+import traceback
+import time
+
+# Cycles device chosen at startup, either 'GPU' or 'CPU'
+RENDER_DEVICE = 'GPU'
+
+# time spent in Cycles for the current job in seconds
+RENDER_TIME = 0.0
+
+# materials per base material and color, see get_material
+MATERIALS = {}
+
+# header and column table of a version 2 atompack, see AtomPackWriter
+ATOMPACK_MAGIC = b'ATOMPACK'
+ATOMPACK_TABLE_DTYPE = np.dtype([('name', 'S24'), ('dtype', 'S4'), ('width', 'u4'),
+                                 ('offset', 'u8'), ('rows', 'u8')])
 
 def main():
     # read input and output file
     
     argv = sys.argv
     argv = argv[argv.index("--") + 1:]
-    inputfile = argv[0]
-    binfile = argv[1]
-    outfile = argv[2]
-    print("Reading: %s" % inputfile)
 
-    print("Searching for GPUs")
-    enable_cycles_gpu()
+    global RENDER_DEVICE
+    RENDER_DEVICE = configure_cycles_device(os.environ.get('SLABRENDER_DEVICE', 'auto'))
+
+    if argv[0] == '--session':
+        run_session()
+    else:
+        render_job(argv[0], argv[1], argv[2])
+
+def run_session():
+    """
+    Keep Blender resident and render the jobs received via stdin
+
+    Every line on stdin holds a JSON object with the paths to the manifest,
+    the atompack and the output image. The scene is reset to the template
+    before every job and completion is reported on stdout.
+    """
+    template = bpy.data.filepath
+    print('SLABRENDER_SESSION_READY', flush=True)
+
+    dirty = False
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+
+        try:
+            job = json.loads(line)
+            if dirty:
+                bpy.ops.wm.open_mainfile(filepath=template)
+            dirty = True
+            render_job(job['manifest'], job['atompack'], job['output'])
+            print('SLABRENDER_JOB_DONE ok', flush=True)
+        except Exception as e:
+            traceback.print_exc()
+            sys.stderr.flush()
+            print('SLABRENDER_JOB_DONE error %s' % e, flush=True)
+
+def render_job(inputfile, binfile, outfile):
+    """
+    Render a single structure and report the time spent per phase
+
+    The start of the job and the durations of building the scene and of
+    rendering are reported on stdout as SLABRENDER_JOB_START and
+    SLABRENDER_TIMING <phase> <seconds> lines.
+    """
+    global RENDER_TIME
+    print('SLABRENDER_JOB_START', flush=True)
+    RENDER_TIME = 0.0
+
+    # materials of a previous job are gone once the template is reloaded
+    MATERIALS.clear()
+    start = time.perf_counter()
+
+    build_and_render(inputfile, binfile, outfile)
+
+    report_timing('scene_build', time.perf_counter() - start - RENDER_TIME)
+    report_timing('render', RENDER_TIME)
+
+def report_timing(phase, seconds):
+    print('SLABRENDER_TIMING %s %.6f' % (phase, seconds), flush=True)
+
+def build_and_render(inputfile, binfile, outfile):
+    """
+    Build the scene for a single structure and render it
+    """
+    print("Reading: %s" % inputfile)
 
     with open(inputfile) as f:
         data = json.load(f)
@@ -43,145 +120,316 @@ def main():
             print('Enable rendering of coordinate axes')
 
     # build molecule
-    matrix = build_molecule(binfile, data)
-    autoscale = max(np.linalg.norm(matrix[:,0]), np.linalg.norm(matrix[:,1]))
+    existing = set(bpy.data.objects)
+    matrix, frames = build_molecule(binfile, data)
+    autoscale = get_autoscale(matrix)
 
     # show the unitcell dimensions using dashed lines
     if data['show_unitcell'] == True:
         show_unitcell(matrix, data)
 
+    # trajectories are rendered as a frame sequence from a single scene
+    if frames is not None:
+        if 'views' in data.keys() and len(data['views']) > 0:
+            print('Ignoring views for animation')
+        build_camera(data, autoscale)
+        run_render(outfile, data, len(frames['positions']))
+        return
+
+    # the scene is built once and rendered from every view
+    if 'views' in data.keys() and len(data['views']) > 0:
+        render_views(data, autoscale, outfile, existing)
+        return
+
     # add a camera
     build_camera(data, autoscale)
 
     # run single image with just the geometry
     run_render(outfile, data)
 
-def run_render(filename, data):
+def render_views(data, autoscale, outfile, existing):
+    """
+    Render the scene once per view
+
+    Every view holds a camera direction and/or object Euler angles. Rather than
+    rebuilding the structure, the objects added for this job are parented to a
+    pivot which is rotated from the base orientation towards the orientation of
+    the view. Images are stored as <outfile>_<name>.png.
+    """
+    pivot = bpy.data.objects.new('Structure', None)
+    bpy.context.scene.collection.objects.link(pivot)
+    for obj in set(bpy.data.objects) - existing:
+        if obj.parent is None and obj != pivot:
+            obj.parent = pivot
+
+    # the geometry has been built in the base orientation
+    if "object_euler" in data.keys():
+        angles = [float(angle) for angle in data["object_euler"].split("/")]
+        base_rotation = matrix_euler_angles(angles[0], angles[1], angles[2])
+    else:
+        base_rotation = np.identity(3)
+
+    root, ext = os.path.splitext(outfile)
+    camera = None
+    for view in data['views']:
+        viewdata = dict(data)
+        viewdata.update(view)
+
+        # the time budget is shared between the views
+        if 'time_limit' in data.keys():
+            viewdata['time_limit'] = data['time_limit'] / len(data['views'])
+
+        if "object_euler" in view.keys():
+            angles = [float(angle) for angle in view["object_euler"].split("/")]
+            rotation = matrix_euler_angles(angles[0], angles[1], angles[2]).dot(base_rotation.T)
+        else:
+            rotation = np.identity(3)
+        pivot.matrix_world = mathutils.Matrix(rotation.tolist()).to_4x4()
+
+        if camera is not None:
+            bpy.data.objects.remove(camera, do_unlink=True)
+        camera = build_camera(viewdata, autoscale)
+
+        print('Rendering view: %s' % view['name'])
+        run_render(root + '_' + view['name'] + ext, viewdata)
+        print('SLABRENDER_VIEW_DONE %s' % view['name'], flush=True)
+
+def run_render(filename, data, nr_frames=0):
+    """
+    Render a still image or, when nr_frames is given, the keyframed animation
+
+    Frames are stored as <filename>_0000.png, <filename>_0001.png, ...
+    """
     scene = bpy.context.scene
     scene.render.engine = 'CYCLES'
-    scene.cycles.device = 'GPU'
+    scene.cycles.device = RENDER_DEVICE
 
     bpy.context.scene.render.resolution_x = data['resolution_x']
     bpy.context.scene.render.resolution_y = data['resolution_y']
     bpy.context.scene.render.resolution_percentage = 100
     bpy.context.scene.cycles.samples = data['samples']
 
+    # stop sampling pixels once their noise is below the threshold, samples is the maximum
+    scene.cycles.use_adaptive_sampling = data.get('adaptive_sampling', False)
+    if scene.cycles.use_adaptive_sampling:
+        scene.cycles.adaptive_threshold = data.get('noise_threshold', 0.01)
+        print('Adaptive sampling with noise threshold %g' % scene.cycles.adaptive_threshold)
+
+    # denoise the final image with OpenImageDenoise on the CPU, guided by albedo and normals
+    scene.cycles.use_denoising = data.get('denoise', False)
+    if scene.cycles.use_denoising:
+        scene.cycles.denoiser = 'OPENIMAGEDENOISE'
+        scene.cycles.denoising_input_passes = 'RGB_ALBEDO_NORMAL'
+        scene.cycles.denoising_prefilter = 'ACCURATE'
+        if hasattr(scene.cycles, 'denoising_use_gpu'):
+            scene.cycles.denoising_use_gpu = False
+        print('Denoising with OpenImageDenoise')
+
+    # render a band of the image; the pixel rows are counted from the top
+    if 'border' in data.keys():
+        x0, y0, x1, y1 = data['border']
+        width = data['resolution_x']
+        height = data['resolution_y']
+        scene.render.use_border = True
+        scene.render.use_crop_to_border = True
+        scene.render.border_min_x = x0 / width
+        scene.render.border_max_x = x1 / width
+        # Blender truncates the border to whole pixels, stay clear of the edges
+        scene.render.border_min_y = min(1.0, (height - y1 + 0.25) / height)
+        scene.render.border_max_y = min(1.0, (height - y0 + 0.25) / height)
+        print('Rendering rows %i to %i' % (y0, y1))
+
+    # identical seeds yield identical noise in overlapping bands
+    if 'seed' in data.keys():
+        scene.cycles.seed = data['seed']
+        scene.cycles.use_animated_seed = False
+
+    # wall clock limit on sampling for jobs that are rendered within a time budget;
+    # the limit applies per frame
+    if 'time_limit' in data.keys() and hasattr(bpy.context.scene.cycles, 'time_limit'):
+        bpy.context.scene.cycles.time_limit = data['time_limit'] / max(1, nr_frames)
+        print('Limiting render time to %.1f seconds' % bpy.context.scene.cycles.time_limit)
+
+    if nr_frames > 0:
+        # keep the scene data (BVH, shaders) between frames, only the transforms change
+        scene.render.use_persistent_data = True
+        scene.frame_start = 0
+        scene.frame_end = nr_frames - 1
+        root, ext = os.path.splitext(filename)
+        scene.render.filepath = root + '_####'
+        scene.render.use_file_extension = True
+        print('Rendering %i frames' % nr_frames)
+        timed_render(animation=True)
+        return
+
     bpy.data.scenes['Scene'].render.filepath = filename
-    bpy.ops.render.render(write_still=True)
+    timed_render(write_still=True)
+
+def timed_render(**kwargs):
+    """
+    Run the render operator and add its duration to the render time of the job
+    """
+    global RENDER_TIME
+    start = time.perf_counter()
+    bpy.ops.render.render(**kwargs)
+    RENDER_TIME += time.perf_counter() - start
 
 def read_binfile(binfile, lib, data):
     """
     Read atom coordinates from .bin file
     """
+    columns = read_atompack(binfile)
+    matrix = np.array(columns['cell'], dtype=np.float64).reshape((3,3))
 
+    # once the atoms are known, a billboarding alignment matrix
+    # can be generated, which is applied to all coordinates
+    rotation_matrix = None
     if "object_euler" in data.keys():
-        rotate_structure = True
         angles = [float(angle) for angle in data["object_euler"].split("/")]
         print("Building rotation matrix from Euler angles: %s" % angles)
         rotation_matrix = matrix_euler_angles(angles[0], angles[1], angles[2])
+    elif "atom_align" in data.keys():
+        atomlist = [int(idx)-1 for idx in data["atom_align"].split(",")]
+        rotation_matrix = matrix_billboard_atoms(atomlist, build_atom_list(lib, data, columns, 'atom'))
+
+    atoms = build_atom_list(lib, data, columns, 'atom', rotation_matrix)
+    bonds = build_bond_list(lib, columns, 'bond', rotation_matrix)
+    atoms_expansion = build_atom_list(lib, data, columns, 'expansion_atom', rotation_matrix)
+    bonds_expansion = build_bond_list(lib, columns, 'expansion_bond', rotation_matrix)
+
+    # animation frames (optional); positions per frame, the unit cell is fixed
+    frames = None
+    if 'frame.position' in columns:
+        nr_frames = len(columns['frame.position'])
+        frame_positions = columns['frame.position'].reshape((nr_frames, len(atoms), 3))
+        if rotation_matrix is not None:
+            frame_positions = frame_positions.dot(rotation_matrix.T)
+        frames = {'positions': list(frame_positions)}
+        print('Read %i animation frames' % nr_frames)
+
+    return atoms, bonds, atoms_expansion, bonds_expansion, matrix, frames
+
+def read_atompack(binfile):
+    """
+    Read the columns of an atompack (version 1 or 2) into numpy arrays
 
-    # read binfile
-    f = open(binfile, 'rb')
+    Columns are named as in version 2 (see AtomPackWriter), rows correspond
+    to atoms, bonds or frames.
+    """
+    with open(binfile, 'rb') as f:
+        buf = f.read()
 
-    # unit cell
-    matrix = np.zeros((3,3))
-    for i in range(0,3):
-        for j in range(0,3):
-            matrix[i,j] = struct.unpack('d', f.read(8))[0]
-
-    # atoms
-    nr_atoms = struct.unpack('I', f.read(4))[0]
-    atoms = []
-    for i in range(0, nr_atoms):
-        el = lib.get_element(struct.unpack('B', f.read(1))[0])
-        x = struct.unpack('d', f.read(8))[0]
-        y = struct.unpack('d', f.read(8))[0]
-        z = struct.unpack('d', f.read(8))[0]
-        if "object_euler" in data.keys():
-            p = np.array([x,y,z])
-            pr = rotation_matrix.dot(p)
-            atoms.append([el, pr[0], pr[1], pr[2]])
-        else:
-            atoms.append([el, x, y, z])
+    if buf[:8] == ATOMPACK_MAGIC:
+        return read_atompack_v2(buf)
+    else:
+        return read_atompack_v1(buf)
 
-    # once the atoms are known, a billboarding alignment matrix
-    # can be generated, but we still need to retroactively apply
-    # this rotation matrix to the atoms
-    if "atom_align" in data.keys() and not "object_euler" in data.keys():
-        rotate_structure = True
-        atomlist = [int(idx)-1 for idx in data["atom_align"].split(",")]
-        rotation_matrix = matrix_billboard_atoms(atomlist, atoms)
-
-        for i in range(0, len(atoms)):
-            p = np.array([atoms[i][1],atoms[i][2],atoms[i][3]])
-            pr = rotation_matrix.dot(p)
-            for j in range(0,3):
-                atoms[i][j+1] = pr[j]
-    elif "object_euler" in data.keys():
-        rotate_structure = True
+def read_atompack_v2(buf):
+    """
+    Read a version 2 atompack: a table of aligned columns, each read in one go
+    """
+    version, nr_columns = struct.unpack_from('II', buf, 8)
+    if version != 2:
+        raise RuntimeError('Unsupported atompack version %i' % version)
+
+    table = np.frombuffer(buf, dtype=ATOMPACK_TABLE_DTYPE, count=nr_columns, offset=16)
+    columns = {}
+    for entry in table:
+        width = int(entry['width'])
+        rows = int(entry['rows'])
+        column = read_array(buf, entry['dtype'].decode(), rows * width, int(entry['offset']))
+        columns[entry['name'].decode()] = column.reshape((rows, width)) if width > 1 else column
+
+    return columns
+
+def read_atompack_v1(buf):
+    """
+    Read a version 1 atompack: interleaved, unaligned records per atom and bond
+    """
+    columns = {'cell': read_array(buf, np.float64, 9, 0)}
+    offset = 9 * 8
+
+    atom_dtype = np.dtype([('element', 'u1'), ('position', 'f8', 3)])
+    bond_dtype = np.dtype([('element', 'u1', 2), ('atom_id', 'u2', 2), ('axis', 'f8', 3),
+                           ('angle', 'f8'), ('length', 'f8')])
+    for prefix in ['', 'expansion_']:
+        nr_atoms = struct.unpack_from('I', buf, offset)[0]
+        records = read_array(buf, atom_dtype, nr_atoms, offset + 4)
+        offset += 4 + nr_atoms * atom_dtype.itemsize
+        columns[prefix + 'atom.element'] = records['element']
+        columns[prefix + 'atom.position'] = records['position']
+
+        nr_bonds = struct.unpack_from('I', buf, offset)[0]
+        records = read_array(buf, bond_dtype, nr_bonds, offset + 4)
+        offset += 4 + nr_bonds * bond_dtype.itemsize
+        for field in bond_dtype.names:
+            columns[prefix + 'bond.' + field] = records[field]
+
+    # animation frames (optional)
+    if len(buf) >= offset + 4:
+        nr_frames = struct.unpack_from('I', buf, offset)[0]
+        nr_atoms = len(columns['atom.element'])
+        frame_dtype = np.dtype([('position', 'f8', nr_atoms * 3)])
+        records = read_array(buf, frame_dtype, nr_frames, offset + 4)
+        columns['frame.position'] = records['position']
+
+    return columns
+
+def read_array(buf, dtype, count, offset):
+    """
+    Read count items without copying, also for empty sections at the end of the buffer
+    """
+    if count == 0:
+        return np.zeros(0, dtype=dtype)
+
+    return np.frombuffer(buf, dtype=dtype, count=count, offset=offset)
+
+def build_atom_list(lib, data, columns, prefix, rotation_matrix=None):
+    """
+    Build the list of [element, x, y, z, radius, RGBA color] from the atompack columns
+
+    Radius and color have been resolved from the custom directives when the
+    atompack was written; for version 1 atompacks they are resolved here.
+    """
+    elements = columns[prefix + '.element'].tolist()
+    positions = columns[prefix + '.position'].reshape((-1,3))
+    if rotation_matrix is not None:
+        positions = positions.dot(rotation_matrix.T)
+
+    names = {atnr: lib.get_element(atnr) for atnr in set(elements)}
+    if prefix + '.radius' in columns:
+        radii = columns[prefix + '.radius'].tolist()
+        rgb = columns[prefix + '.color'].reshape((-1,3)) / 255.0
+        colors = np.hstack([rgb, np.ones((len(rgb), 1))]).tolist()
     else:
-        rotate_structure = False
+        radii = [get_atom_scale(lib, data, names[atnr], i) for i, atnr in enumerate(elements)]
+        colors = [hex2rgb(get_atom_color(lib, data, names[atnr], i), _tuple=True) for i, atnr in enumerate(elements)]
+
+    return [[names[atnr], x, y, z, radius, color]
+            for atnr, (x, y, z), radius, color in zip(elements, positions.tolist(), radii, colors)]
+
+def build_bond_list(lib, columns, prefix, rotation_matrix=None):
+    """
+    Build the list of [element1, element2, id1, id2, axis x, y, z, angle, length]
+    from the atompack columns
+    """
+    elements = columns[prefix + '.element'].reshape((-1,2)).tolist()
+    names = {atnr: lib.get_element(atnr) for pair in elements for atnr in pair}
+    atom_ids = columns[prefix + '.atom_id'].reshape((-1,2)).tolist()
+    axes = columns[prefix + '.axis'].reshape((-1,3))
+    angles = columns[prefix + '.angle'].reshape(-1)
+    lengths = columns[prefix + '.length'].reshape(-1).tolist()
 
-    # bonds
-    nr_bonds = struct.unpack('I', f.read(4))[0]
     bonds = []
-    for i in range(0, nr_bonds):
-        el1 = lib.get_element(struct.unpack('B', f.read(1))[0])
-        el2 = lib.get_element(struct.unpack('B', f.read(1))[0])
-        id1 = struct.unpack('H', f.read(2))[0]
-        id2 = struct.unpack('H', f.read(2))[0]
-        ax = struct.unpack('d', f.read(8))[0]
-        ay = struct.unpack('d', f.read(8))[0]
-        az = struct.unpack('d', f.read(8))[0]
-        angle = struct.unpack('d', f.read(8))[0]
-        length = struct.unpack('d', f.read(8))[0]
-
-        if rotate_structure:
-            bondrotation = build_rotation_matrix(np.array([ax,ay,az]), angle)
-            newrotation = np.dot(rotation_matrix, bondrotation)
-            axis, angle = get_axis_angle_from_matrix(newrotation)
-            bonds.append([el1, el2, id1, id2, axis[0], axis[1], axis[2], angle, length])
-        else:
-            bonds.append([el1, el2, id1, id2, ax, ay, az, angle, length])
-
-    # atoms expansion
-    nr_atoms_expansion = struct.unpack('I', f.read(4))[0]
-    atoms_expansion = []
-    for i in range(0, nr_atoms_expansion):
-        el = lib.get_element(struct.unpack('B', f.read(1))[0])
-        x = struct.unpack('d', f.read(8))[0]
-        y = struct.unpack('d', f.read(8))[0]
-        z = struct.unpack('d', f.read(8))[0]
-        if rotate_structure:
-            p = np.array([x,y,z])
-            pr = rotation_matrix.dot(p)
-            atoms_expansion.append([el, pr[0], pr[1], pr[2]])
-        else:
-            atoms_expansion.append([el, x, y, z])
-
-    # bonds expansion
-    nr_bonds_expansion = struct.unpack('I', f.read(4))[0]
-    bonds_expansion = []
-    for i in range(0, nr_bonds_expansion):
-        el1 = lib.get_element(struct.unpack('B', f.read(1))[0])
-        el2 = lib.get_element(struct.unpack('B', f.read(1))[0])
-        id1 = struct.unpack('H', f.read(2))[0]
-        id2 = struct.unpack('H', f.read(2))[0]
-        ax = struct.unpack('d', f.read(8))[0]
-        ay = struct.unpack('d', f.read(8))[0]
-        az = struct.unpack('d', f.read(8))[0]
-        angle = struct.unpack('d', f.read(8))[0]
-        length = struct.unpack('d', f.read(8))[0]
-
-        if rotate_structure:
-            bondrotation = build_rotation_matrix(np.array([ax,ay,az]), angle)
-            newrotation = rotation_matrix.dot(bondrotation)
-            axis, angle = get_axis_angle_from_matrix(newrotation)
-            bonds_expansion.append([el1, el2, id1, id2, axis[0], axis[1], axis[2], angle, length])
-        else:
-            bonds_expansion.append([el1, el2, id1, id2, ax, ay, az, angle, length])
+    for i, ((el1, el2), (id1, id2)) in enumerate(zip(elements, atom_ids)):
+        axis = axes[i]
+        angle = angles[i]
+        if rotation_matrix is not None:
+            bondrotation = build_rotation_matrix(axis, angle)
+            axis, angle = get_axis_angle_from_matrix(rotation_matrix.dot(bondrotation))
+        bonds.append([names[el1], names[el2], id1, id2, float(axis[0]), float(axis[1]), float(axis[2]), float(angle), lengths[i]])
 
-    return atoms, bonds, atoms_expansion, bonds_expansion, matrix
+    return bonds
 
 def build_molecule(xyzfile, data):
     """
@@ -189,15 +437,69 @@ def build_molecule(xyzfile, data):
     """
     lib = AtomSettings()
 
-    atoms, bonds, atoms_expansion, bonds_expansion, matrix = read_binfile(xyzfile, lib, data)
-    build_atoms(atoms, lib, data)
-    build_bonds(atoms, bonds, lib, data)
-
-    if data['expansion'] == True:
+    atoms, bonds, atoms_expansion, bonds_expansion, matrix, frames = read_binfile(xyzfile, lib, data)
+
+    # the level of detail of the meshes depends on the size of an atom in the image
+    data['pixels_per_angstrom'] = get_pixels_per_angstrom(data, matrix)
+    print('Level of detail for %.1f pixels per angstrom' % data['pixels_per_angstrom'])
+
+    # animations keyframe the individual objects, hence cannot use instancing
+    if data.get('instancing', False) and frames is None:
+        build_atoms_instanced(atoms, lib, data)
+        build_bonds_instanced(atoms, bonds, lib, data)
+        if data['expansion'] == True:
+            build_atoms_instanced(atoms_expansion, lib, data)
+            build_bonds_instanced(atoms + atoms_expansion, bonds_expansion, lib, data)
+        return matrix, frames
+
+    atom_objects = build_atoms(atoms, lib, data)
+    bond_objects = build_bonds(atoms, bonds, lib, data)
+
+    if frames is not None:
+        # periodic images would not follow the atoms
+        if data['expansion'] == True:
+            print('Ignoring expansion for animation')
+        keyframe_molecule(atom_objects, bond_objects, frames)
+    elif data['expansion'] == True:
         build_atoms(atoms_expansion, lib, data)
         build_bonds(atoms + atoms_expansion, bonds_expansion, lib, data)
 
-    return matrix
+    return matrix, frames
+
+def keyframe_molecule(atom_objects, bond_objects, frames):
+    """
+    Insert a keyframe per animation frame for the atoms and bonds
+
+    Objects are built once for the first frame; for every subsequent frame
+    only the atom locations and the bond locations, orientations and lengths
+    are keyframed.
+    """
+    zaxis = np.array([0.0, 0.0, 1.0])
+    for frame, positions in enumerate(frames['positions']):
+        for obj, pos in zip(atom_objects, positions):
+            obj.location = pos
+            obj.keyframe_insert(data_path='location', frame=frame)
+
+        for obj, id1, id2, fraction, lengthscale in bond_objects:
+            p1 = positions[id1]
+            p2 = positions[id2]
+            vec = p2 - p1
+            length = np.linalg.norm(vec)
+
+            # rotate the z-axis of the cylinder onto the bond
+            axis = np.cross(zaxis, vec / length)
+            if np.linalg.norm(axis) < 1e-8:
+                axis = np.array([1.0, 0.0, 0.0])
+            else:
+                axis = axis / np.linalg.norm(axis)
+            angle = np.arccos(np.clip(np.dot(zaxis, vec / length), -1.0, 1.0))
+
+            obj.location = p1 + fraction * vec
+            obj.rotation_axis_angle = (angle, axis[0], axis[1], axis[2])
+            obj.scale.z = length * lengthscale
+            obj.keyframe_insert(data_path='location', frame=frame)
+            obj.keyframe_insert(data_path='rotation_axis_angle', frame=frame)
+            obj.keyframe_insert(data_path='scale', frame=frame)
 
 def show_unitcell(matrix, data):
     """
@@ -235,7 +537,7 @@ def show_unitcell(matrix, data):
 
     # enable freestyle settings
     bpy.context.scene.render.use_freestyle = True
-    freestyle_settings = bpy.context.window.view_layer.freestyle_settings
+    freestyle_settings = bpy.context.view_layer.freestyle_settings
     lineset = freestyle_settings.linesets.active
     lineset.select_silhouette = False
     lineset.select_edge_mark = True
@@ -291,6 +593,21 @@ def build_rotation_matrix(rotation_data):
 
     return matrix
 
+def get_autoscale(matrix):
+    """
+    Automatic camera scale derived from the unit cell
+    """
+    return max(np.linalg.norm(matrix[:,0]), np.linalg.norm(matrix[:,1]))
+
+def get_ortho_scale(data, autoscale):
+    """
+    Width of the area captured by the orthogonal camera in angstrom
+    """
+    if data['ortho_scale'] == 'auto':
+        return autoscale + 5.0
+    else:
+        return float(data['ortho_scale'])
+
 def build_camera(data, autoscale):
     """
     Build an orthogonal camera object
@@ -334,49 +651,36 @@ def build_camera(data, autoscale):
     camera_object.data.type = 'ORTHO'
     bpy.context.scene.collection.objects.link(camera_object)
     bpy.context.scene.camera = camera_object
-    if data['ortho_scale'] == 'auto':
-        camera_object.data.ortho_scale = autoscale + 5.0
-    else:
-        camera_object.data.ortho_scale = float(data['ortho_scale'])
+    camera_object.data.ortho_scale = get_ortho_scale(data, autoscale)
     print("Setting camera ortho scale to %f" % camera_object.data.ortho_scale)
     camera_object.data.clip_end = 1000
 
+    return camera_object
+
 def build_atoms(atoms, lib, data):
     """
     Build atoms based on list of atoms
     """
-    # build a high-poly sphere
-    if 'nsubdiv' in data.keys():
-        nsubdiv = data['nsubdiv']
-    else:
-        nsubdiv = 4
-    bpy.ops.mesh.primitive_ico_sphere_add(subdivisions=nsubdiv, location=(0,0,0))
-    ob = bpy.context.object
-    bpy.ops.object.shade_smooth()
-    material = bpy.data.materials.get('specular')
-    ob.data.materials.append(material)
+    # spheres per level of detail, built on demand
+    primitives = {}
 
     # construct atoms
     counter = 0
     atomlist = []
+    objects = []
     for counter,at in enumerate(atoms):
 
-        # copy materials
-        bpy.data.materials[data['atmat']].copy().name = "atom%4i" % counter
-
         x = at[1]
         y = at[2]
         z = at[3]
 
         # change atom scale
-        scale = lib.get_scale(at[0])
-        if 'atom_radii' in data.keys():
-            for mod in data['atom_radii']:
-                pieces = mod.split('/')
-                if pieces[0] == at[0] and (counter+1) >= int(pieces[1]) and (counter+1) <= int(pieces[2]):
-                    scale = float(pieces[3])
-                if pieces[0] == at[0] and int(pieces[1])==0 and int(pieces[2]) == 0:
-                    scale = float(pieces[3])
+        scale = at[4]
+
+        nsubdiv = get_sphere_subdivisions(data, scale)
+        if nsubdiv not in primitives:
+            primitives[nsubdiv] = build_primitive('ico_sphere', nsubdiv)
+        ob = primitives[nsubdiv]
 
         copy = ob.copy()
         copy.data = ob.data.copy()
@@ -387,65 +691,40 @@ def build_atoms(atoms, lib, data):
         copy.scale.y = scale
         copy.scale.z = scale
 
-        material = bpy.data.materials.get("atom%4i" % counter)
-        copy.data.materials[0] = material
-        color = lib.get_color(at[0])
-
-        # change color based on specific directives
-        scale = lib.get_scale(at[0])
-        if 'atom_colors' in data.keys():
-            for mod in data['atom_colors']:
-                pieces = mod.split('/')
-                if pieces[0] == at[0] and (counter+1) >= int(pieces[1]) and (counter+1) <= int(pieces[2]):
-                    color = pieces[3]
-                if pieces[0] == at[0] and int(pieces[1])==0 and int(pieces[2]) == 0:
-                    color = pieces[3]
+        # color including the custom directives
+        copy.data.materials[0] = get_material(data['atmat'], at[5])
 
         atomlist.append(at[0])
-        bpy.data.materials["atom%4i" % counter].node_tree.nodes["RGB"].outputs[0].default_value = hex2rgb(color, _tuple=True)
 
         bpy.context.collection.objects.link(copy)
+        objects.append(copy)
 
-    # remove high-poly sphere
+    # remove high-poly spheres
     bpy.ops.object.select_all(action='DESELECT')
-    bpy.data.objects['Icosphere'].select_set(True)
+    for ob in primitives.values():
+        ob.select_set(True)
     bpy.ops.object.delete()
 
+    return objects
+
 def build_bonds(atoms, bonds, lib, data):
     """
     Build bonds between atoms based on list of atoms
     """
-    # build a high-poly cylinder
-    bpy.ops.mesh.primitive_cylinder_add(vertices=128, location=(0,0,0))
-    ob = bpy.context.object
-    bpy.ops.object.shade_flat()
-    material = bpy.data.materials.get('specular')
-    ob.data.materials.append(material)
+    # cylinders per level of detail, built on demand
+    primitives = {}
 
+    # tubes with their bond, position along the bond and length relative to the bond
+    objects = []
     for i,bond in enumerate(bonds):
 
         # establish diameter
-        scale1 = lib.get_scale(bond[0])
-        scale2 = lib.get_scale(bond[1])
-
-        # overrule scales
-        if 'atom_radii' in data.keys():
-            for mod in data['atom_radii']:
-                pieces = mod.split('/')
-                if pieces[0] == bond[0] and (bond[2]+1) >= int(pieces[1]) and (bond[2]+1) <= int(pieces[2]):
-                    scale1 = float(pieces[3])
-                if pieces[0] == bond[1] and (bond[3]+1) >= int(pieces[1]) and (bond[3]+1) <= int(pieces[2]):
-                    scale2 = float(pieces[3])
-                if pieces[0] == bond[0] and int(pieces[1])==0 and int(pieces[2])==0:
-                    scale1 = float(pieces[3])
-                if pieces[0] == bond[1] and int(pieces[1])==0 and int(pieces[2])==0:
-                    scale2 = float(pieces[3])
-
-        diam = np.min([scale1, scale2]) / 2.0
-        diam = min(diam, 0.4)
-
-        # copy materials
-        bpy.data.materials[data['bondmat']].copy().name = "bondu%4i" % i
+        diam = get_bond_diameter(atoms, bond)
+
+        vertices = get_cylinder_vertices(data, diam)
+        if vertices not in primitives:
+            primitives[vertices] = build_primitive('cylinder', vertices)
+        ob = primitives[vertices]
 
         # upper tube
         copy = ob.copy()
@@ -473,23 +752,15 @@ def build_bonds(atoms, bonds, lib, data):
         copy.rotation_axis_angle[1] = bond[4]
         copy.rotation_axis_angle[2] = bond[5]
         copy.rotation_axis_angle[3] = bond[6]
-        material = bpy.data.materials.get("bondu%4i" % i)
-        copy.data.materials[0] = material
-
-        # get default color from library
-        color = lib.get_color(atoms[bond[2]][0])
-
-        # overrule color
-        if 'atom_colors' in data.keys():
-            for mod in data['atom_colors']:
-                pieces = mod.split('/')
-                if pieces[0] == atoms[bond[2]][0] and (bond[2]+1) >= int(pieces[1]) and (bond[2]+1) <= int(pieces[2]):
-                    color = pieces[3]
-                if pieces[0] == atoms[bond[2]][0] and int(pieces[1])==0 and int(pieces[2])==0:
-                    color = pieces[3]
-
-        bpy.data.materials["bondu%4i" % i].node_tree.nodes["RGB"].outputs[0].default_value = darken(hex2rgb(color, _tuple=True), 0.5)
+
+        # color of the atom the tube is attached to
+        copy.data.materials[0] = get_material(data['bondmat'], darken(atoms[bond[2]][5], 0.5))
+
         bpy.context.collection.objects.link(copy)
+        if bond[0] == bond[1]:
+            objects.append((copy, bond[2], bond[3], 0.5, 0.5))
+        else:
+            objects.append((copy, bond[2], bond[3], 0.25, 0.25))
 
         # lower tube
         if bond[0] != bond[1]:
@@ -509,29 +780,289 @@ def build_bonds(atoms, bonds, lib, data):
             copy.rotation_axis_angle[1] = bond[4]
             copy.rotation_axis_angle[2] = bond[5]
             copy.rotation_axis_angle[3] = bond[6]
-            material = bpy.data.materials.get("bondu%4i" % i)
-            copy.data.materials[0] = material
-
-            # get default color from library
-            color = lib.get_color(atoms[bond[3]][0])
-
-            # overrule color
-            if 'atom_colors' in data.keys():
-                for mod in data['atom_colors']:
-                    pieces = mod.split('/')
-                    if pieces[0] == atoms[bond[3]][0] and (bond[3]+1) >= int(pieces[1]) and (bond[3]+1) <= int(pieces[2]):
-                        color = pieces[3]
-                    if pieces[0] == atoms[bond[3]][0] and int(pieces[1])==0 and int(pieces[2])==0:
-                        color = pieces[3]
-
-            bpy.data.materials["bondu%4i" % i].node_tree.nodes["RGB"].outputs[0].default_value = darken(hex2rgb(color, _tuple=True), 0.5)
+
+            # color of the atom the tube is attached to
+            copy.data.materials[0] = get_material(data['bondmat'], darken(atoms[bond[3]][5], 0.5))
+
             bpy.context.collection.objects.link(copy)
+            objects.append((copy, bond[2], bond[3], 0.75, 0.25))
 
-    # remove cylinder
+    # remove cylinders
     bpy.ops.object.select_all(action='DESELECT')
-    bpy.data.objects['Cylinder'].select_set(True)
+    for ob in primitives.values():
+        ob.select_set(True)
     bpy.ops.object.delete()
 
+    return objects
+
+def build_atoms_instanced(atoms, lib, data):
+    """
+    Build atoms as instances of a sphere
+
+    The atoms are the vertices of a mesh without faces, on which a geometry
+    nodes modifier instances the sphere; atoms with a different level of
+    detail are placed on a separate mesh. Radius and color are stored as
+    attributes of the vertices, such that the number of datablocks does not
+    depend on the number of atoms.
+    """
+    positions = np.array([at[1:4] for at in atoms], dtype=np.float64).reshape((-1,3))
+    radii = np.array([at[4] for at in atoms], dtype=np.float64)
+    colors = np.array([at[5] for at in atoms], dtype=np.float64).reshape((-1,4))
+
+    # an instancer per level of detail
+    material = build_instance_material(data['atmat'], 'atom_instanced')
+    levels = np.array([get_sphere_subdivisions(data, radius) for radius in radii], dtype=int)
+    objects = []
+    for nsubdiv in sorted(set(levels.tolist())):
+        selection = levels == nsubdiv
+        scales = np.repeat(radii[selection].reshape((-1,1)), 3, axis=1)
+        objects.append(build_instancer('atoms', positions[selection], np.zeros_like(scales), scales, colors[selection],
+                                       'ico_sphere', nsubdiv, material))
+
+    return objects
+
+def build_bonds_instanced(atoms, bonds, lib, data):
+    """
+    Build bonds as instances of a cylinder, see build_atoms_instanced
+
+    Like build_bonds, a bond between different elements consists of two
+    tubes, each colored after the atom it is attached to.
+    """
+    tubes_per_level = {}
+    for bond in bonds:
+        diam = get_bond_diameter(atoms, bond)
+        centers, rotations, scales, colors = tubes_per_level.setdefault(get_cylinder_vertices(data, diam), ([], [], [], []))
+        rotation = tuple(mathutils.Quaternion((bond[4], bond[5], bond[6]), bond[7]).to_euler('XYZ'))
+        p1 = np.array(atoms[bond[2]][1:4])
+        p2 = np.array(atoms[bond[3]][1:4])
+        color1 = darken(atoms[bond[2]][5], 0.5)
+
+        if bond[0] == bond[1]:
+            tubes = [((p1 + p2) / 2.0, bond[8] / 2.0, color1)]
+        else:
+            color2 = darken(atoms[bond[3]][5], 0.5)
+            tubes = [((3.0 * p1 + p2) / 4.0, bond[8] / 4.0, color1),
+                     ((p1 + 3.0 * p2) / 4.0, bond[8] / 4.0, color2)]
+
+        for center, length, color in tubes:
+            centers.append(center)
+            rotations.append(rotation)
+            scales.append((diam, diam, length))
+            colors.append(color)
+
+    # an instancer per level of detail
+    material = build_instance_material(data['bondmat'], 'bond_instanced')
+    objects = []
+    for vertices in sorted(tubes_per_level.keys()):
+        centers, rotations, scales, colors = tubes_per_level[vertices]
+        objects.append(build_instancer('bonds', centers, rotations, scales, colors, 'cylinder', vertices, material))
+
+    return objects
+
+def build_instancer(name, positions, rotations, scales, colors, primitive, resolution, material):
+    """
+    Build an object that instances a primitive on every position
+
+    @param      rotations   Euler angles per instance
+    @param      scales      scale per instance along x, y and z
+    @param      colors      RGBA color per instance, read by the material
+    """
+    positions = np.array(positions, dtype=np.float32).reshape((-1,3))
+    mesh = bpy.data.meshes.new(name)
+    mesh.vertices.add(len(positions))
+    mesh.vertices.foreach_set('co', positions.ravel())
+    for attribute_name, attribute_type, key, values, width in [('rotation', 'FLOAT_VECTOR', 'vector', rotations, 3),
+                                                               ('scale', 'FLOAT_VECTOR', 'vector', scales, 3),
+                                                               ('color', 'FLOAT_COLOR', 'color', colors, 4)]:
+        attribute = mesh.attributes.new(attribute_name, attribute_type, 'POINT')
+        attribute.data.foreach_set(key, np.array(values, dtype=np.float32).reshape((-1,width)).ravel())
+    mesh.update()
+
+    ob = bpy.data.objects.new(name, mesh)
+    bpy.context.collection.objects.link(ob)
+    modifier = ob.modifiers.new(name='instancing', type='NODES')
+    modifier.node_group = build_instancing_nodes(name, primitive, resolution, material)
+
+    return ob
+
+def build_instancing_nodes(name, primitive, resolution, material):
+    """
+    Geometry nodes that instance a primitive on the points of the geometry,
+    rotated and scaled by the 'rotation' and 'scale' point attributes
+    """
+    tree = bpy.data.node_groups.new(name, 'GeometryNodeTree')
+    if hasattr(tree, 'interface'):
+        # Blender 4.0 and newer
+        tree.interface.new_socket('Geometry', in_out='INPUT', socket_type='NodeSocketGeometry')
+        tree.interface.new_socket('Geometry', in_out='OUTPUT', socket_type='NodeSocketGeometry')
+    else:
+        tree.inputs.new('NodeSocketGeometry', 'Geometry')
+        tree.outputs.new('NodeSocketGeometry', 'Geometry')
+
+    nodes = tree.nodes
+    links = tree.links
+    group_input = nodes.new('NodeGroupInput')
+    group_output = nodes.new('NodeGroupOutput')
+
+    # same primitives as build_atoms and build_bonds
+    if primitive == 'ico_sphere':
+        mesh = nodes.new('GeometryNodeMeshIcoSphere')
+        mesh.inputs['Radius'].default_value = 1.0
+        mesh.inputs['Subdivisions'].default_value = resolution
+    else:
+        mesh = nodes.new('GeometryNodeMeshCylinder')
+        mesh.inputs['Vertices'].default_value = resolution
+        mesh.inputs['Radius'].default_value = 1.0
+        mesh.inputs['Depth'].default_value = 2.0
+    shading = nodes.new('GeometryNodeSetShadeSmooth')
+    shading.inputs['Shade Smooth'].default_value = (primitive == 'ico_sphere')
+    set_material = nodes.new('GeometryNodeSetMaterial')
+    set_material.inputs['Material'].default_value = material
+
+    instances = nodes.new('GeometryNodeInstanceOnPoints')
+    links.new(mesh.outputs['Mesh'], shading.inputs['Geometry'])
+    links.new(shading.outputs['Geometry'], set_material.inputs['Geometry'])
+    links.new(group_input.outputs[0], instances.inputs['Points'])
+    links.new(set_material.outputs['Geometry'], instances.inputs['Instance'])
+    for attribute_name, socket in [('rotation', 'Rotation'), ('scale', 'Scale')]:
+        attribute = nodes.new('GeometryNodeInputNamedAttribute')
+        attribute.data_type = 'FLOAT_VECTOR'
+        attribute.inputs['Name'].default_value = attribute_name
+        output = next(s for s in attribute.outputs if s.enabled)
+        links.new(output, instances.inputs[socket])
+    links.new(instances.outputs['Instances'], group_output.inputs[0])
+
+    return tree
+
+def get_material(base, color):
+    """
+    Copy of a material with the given RGBA color in its RGB node
+
+    Copies are shared by all objects of the same base material and color,
+    such that a structure only needs a material per element.
+    """
+    key = (base, tuple(color))
+    if key not in MATERIALS:
+        material = bpy.data.materials[base].copy()
+        material.name = '%s_%02x%02x%02x' % ((base,) + tuple(int(round(c * 255)) for c in color[:3]))
+        material.node_tree.nodes["RGB"].outputs[0].default_value = color
+        MATERIALS[key] = material
+
+    return MATERIALS[key]
+
+def build_instance_material(base, name):
+    """
+    Copy of a material whose color is taken from the 'color' attribute of
+    the instance rather than from its RGB node
+    """
+    material = bpy.data.materials[base].copy()
+    material.name = name
+    tree = material.node_tree
+    attribute = tree.nodes.new('ShaderNodeAttribute')
+    attribute.attribute_type = 'INSTANCER'
+    attribute.attribute_name = 'color'
+    for link in list(tree.nodes['RGB'].outputs[0].links):
+        tree.links.new(attribute.outputs['Color'], link.to_socket)
+
+    return material
+
+def build_primitive(primitive, resolution):
+    """
+    Build the mesh that atoms or bonds are copied from
+
+    @param      primitive   'ico_sphere' or 'cylinder'
+    @param      resolution  subdivisions of the sphere or vertices of the cylinder
+    """
+    if primitive == 'ico_sphere':
+        bpy.ops.mesh.primitive_ico_sphere_add(subdivisions=resolution, location=(0,0,0))
+        bpy.ops.object.shade_smooth()
+    else:
+        bpy.ops.mesh.primitive_cylinder_add(vertices=resolution, location=(0,0,0))
+        bpy.ops.object.shade_flat()
+    ob = bpy.context.object
+    material = bpy.data.materials.get('specular')
+    ob.data.materials.append(material)
+
+    return ob
+
+def get_pixels_per_angstrom(data, matrix):
+    """
+    Size of an angstrom in the image, as set up by build_camera
+    """
+    autoscale = get_autoscale(matrix)
+    resolution = max(data['resolution_x'], data['resolution_y'])
+
+    return resolution / get_ortho_scale(data, autoscale)
+
+def get_sphere_subdivisions(data, radius):
+    """
+    Icosphere subdivisions for an atom with the given radius
+
+    The level of detail follows from the size of the atom in the image, such
+    that the segments of its outline span at most lod_segment_pixels pixels.
+    nsubdiv is the upper bound.
+    """
+    nsubdiv = data.get('nsubdiv', 4)
+    segment = data.get('lod_segment_pixels', 0)
+    pixels_per_angstrom = data.get('pixels_per_angstrom', 0)
+    if segment <= 0 or pixels_per_angstrom <= 0:
+        return nsubdiv
+
+    # the outline of an icosphere with n subdivisions has about 5 * 2^n edges
+    nr_segments = 2.0 * np.pi * radius * pixels_per_angstrom / segment
+    level = int(np.ceil(np.log2(max(nr_segments / 5.0, 1.0))))
+
+    return min(nsubdiv, max(1, level))
+
+def get_cylinder_vertices(data, radius):
+    """
+    Number of vertices of a bond with the given radius, see get_sphere_subdivisions
+    """
+    segment = data.get('lod_segment_pixels', 0)
+    pixels_per_angstrom = data.get('pixels_per_angstrom', 0)
+    if segment <= 0 or pixels_per_angstrom <= 0:
+        return 128
+
+    # multiples of 8 keep the number of distinct meshes small
+    nr_segments = 2.0 * np.pi * radius * pixels_per_angstrom / segment
+    return int(min(128, max(8, 8 * np.ceil(nr_segments / 8.0))))
+
+def get_atom_scale(lib, data, element, index):
+    """
+    Radius of an atom, overruled by the atom_radii directives
+    (element/first/last/radius with 1-based indices, 0/0 for all atoms)
+
+    Only used for version 1 atompacks, see AtomStyle for newer ones.
+    """
+    scale = lib.get_scale(element)
+    for mod in data.get('atom_radii', []):
+        pieces = mod.split('/')
+        if pieces[0] == element and ((index+1) >= int(pieces[1]) and (index+1) <= int(pieces[2]) or
+                                     int(pieces[1]) == 0 and int(pieces[2]) == 0):
+            scale = float(pieces[3])
+
+    return scale
+
+def get_atom_color(lib, data, element, index):
+    """
+    Hex color of an atom, overruled by the atom_colors directives
+    (element/first/last/color, see get_atom_scale)
+    """
+    color = lib.get_color(element)
+    for mod in data.get('atom_colors', []):
+        pieces = mod.split('/')
+        if pieces[0] == element and ((index+1) >= int(pieces[1]) and (index+1) <= int(pieces[2]) or
+                                     int(pieces[1]) == 0 and int(pieces[2]) == 0):
+            color = pieces[3]
+
+    return color
+
+def get_bond_diameter(atoms, bond):
+    """
+    Diameter of a bond: half the radius of the smaller atom, at most 0.4
+    """
+    return min(min(atoms[bond[2]][4], atoms[bond[3]][4]) / 2.0, 0.4)
+
 def hex2rgb(_hex,_tuple=False):
     """
     @brief      Converts RGB code to numeric values
@@ -719,22 +1250,47 @@ class AtomSettings:
         else:
             raise Exception('Could not find element: %s' % el)
 
-def enable_cycles_gpu():
+def configure_cycles_device(preference):
+    """
+    Select the compute backend of Cycles and return the device to render on
+
+    With preference 'auto' the first backend exposing a GPU is used and Cycles
+    falls back to the CPU when there is none; 'cpu' skips the GPU search. The
+    number of CPU threads is set by the caller via Blender's -t argument.
+    """
     prefs = bpy.context.preferences
     cycles_prefs = prefs.addons['cycles'].preferences
 
-    # Force device discovery
-    cycles_prefs.get_devices()
-
-    # Prefer OPTIX, fallback to CUDA
-    if 'OPTIX' in cycles_prefs.compute_device_type:
-        cycles_prefs.compute_device_type = 'OPTIX'
-    else:
-        cycles_prefs.compute_device_type = 'CUDA'
+    if preference.lower() != 'cpu':
+        print("Searching for GPUs")
+        for backend in ('OPTIX', 'CUDA', 'HIP', 'ONEAPI', 'METAL'):
+            try:
+                cycles_prefs.compute_device_type = backend
+            except TypeError:
+                # backend is not supported by this build or platform
+                continue
+
+            # force device discovery
+            cycles_prefs.get_devices()
+            gpus = [d for d in cycles_prefs.devices if d.type == backend]
+            if not gpus:
+                continue
+
+            # render on the GPUs only, the CPU threads are left to the other workers
+            for device in cycles_prefs.devices:
+                device.use = device.type == backend
+                if device.use:
+                    print(f"Using device: {device.name} ({device.type})")
+            return 'GPU'
+
+        if preference.lower() == 'gpu':
+            print("Warning: no GPU found, rendering on the CPU")
+        else:
+            print("No GPU found, rendering on the CPU")
 
-    for device in cycles_prefs.devices:
-        device.use = True
-        print(f"Using device: {device.name} ({device.type})")
+    cycles_prefs.compute_device_type = 'NONE'
+    print("Using device: CPU (%i threads)" % bpy.context.scene.render.threads)
+    return 'CPU'
 
 if __name__ == '__main__':
     main()
@@ -0,0 +1,233 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+/**
+ * Throughput benchmark of the render queue
+ *
+ * Generates a folder of synthetic POSCAR files and renders it with
+ * ThreadRenderImage using slabrender-standin in place of Blender, such that
+ * the overhead of the queue itself can be measured on any Linux machine.
+ * Progress and the final report are written to stdout as JSON lines.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include "threadrenderimage.h"
+
+namespace {
+
+bool verbose = false;
+
+void bench_message_output(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    Q_UNUSED(context);
+
+    // the queue logs every job, which would dominate the measurement
+    if(type == QtDebugMsg || type == QtInfoMsg) {
+        if(verbose) {
+            std::cerr << "[D] " << msg.toStdString() << std::endl;
+        }
+        return;
+    }
+
+    std::cerr << (type == QtWarningMsg ? "[W] " : "[E] ") << msg.toStdString() << std::endl;
+    if(type == QtFatalMsg) {
+        abort();
+    }
+}
+
+void print_event(const QString& event, QJsonObject data = QJsonObject()) {
+    data.insert("event", event);
+    std::fputs(QJsonDocument(data).toJson(QJsonDocument::Compact).constData(), stdout);
+    std::fputs("\n", stdout);
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Resident and peak memory of this process in kilobytes, -1 when unknown
+ */
+QPair<qint64, qint64> read_memory() {
+    qint64 rss = -1;
+    qint64 peak = -1;
+    QFile status("/proc/self/status");
+    if(status.open(QIODevice::ReadOnly)) {
+        for(const QByteArray& line : status.readAll().split('\n')) {
+            QList<QByteArray> fields = line.simplified().split(' ');
+            if(fields.size() >= 2 && fields[0] == "VmRSS:") {
+                rss = fields[1].toLongLong();
+            } else if(fields.size() >= 2 && fields[0] == "VmHWM:") {
+                peak = fields[1].toLongLong();
+            }
+        }
+    }
+
+    return qMakePair(rss, peak);
+}
+
+/**
+ * @brief Write a POSCAR with randomly placed atoms in a cubic cell
+ */
+void write_poscar(const QString& path, int nr_atoms, unsigned int seed) {
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        throw std::runtime_error("Could not write " + path.toStdString());
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    int nr_oxygen = nr_atoms / 2;
+
+    QTextStream out(&file);
+    out << "Synthetic structure " << seed << "\n1.0\n";
+    out << "10.0 0.0 0.0\n0.0 10.0 0.0\n0.0 0.0 10.0\n";
+    out << "Cu O\n" << (nr_atoms - nr_oxygen) << " " << nr_oxygen << "\nDirect\n";
+    for(int i=0; i<nr_atoms; i++) {
+        out << distribution(generator) << " " << distribution(generator) << " " << distribution(generator) << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("slabrender-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of the render queue using a stand-in for Blender.");
+    parser.addHelpOption();
+    QCommandLineOption option_jobs({"n", "jobs"}, "Number of structures (default: 1000).", "count", "1000");
+    QCommandLineOption option_atoms({"a", "atoms"}, "Atoms per structure (default: 32).", "count", "32");
+    QCommandLineOption option_workers({"w", "workers"}, "Concurrent jobs (default: 4).", "count", "4");
+    QCommandLineOption option_time("time", "Seconds the stand-in spends per job (default: 0).", "seconds", "0");
+    QCommandLineOption option_compute("compute", "Let the stand-in keep a core busy instead of sleeping.");
+    QCommandLineOption option_session("session", "Keep a stand-in process per worker (session mode).");
+    QCommandLineOption option_standin("standin", "Stand-in executable (default: slabrender-standin next to this program).", "executable");
+    QCommandLineOption option_verbose({"v", "verbose"}, "Keep the debug output of the queue.");
+    parser.addOptions({option_jobs, option_atoms, option_workers, option_time, option_compute,
+                       option_session, option_standin, option_verbose});
+    parser.process(app);
+
+    verbose = parser.isSet(option_verbose);
+    qInstallMessageHandler(bench_message_output);
+
+    int nr_jobs = std::max(1, parser.value(option_jobs).toInt());
+    int nr_atoms = std::max(2, parser.value(option_atoms).toInt());
+    int nr_workers = std::max(1, parser.value(option_workers).toInt());
+    double job_time = std::max(0.0, parser.value(option_time).toDouble());
+    QString standin = parser.isSet(option_standin) ? parser.value(option_standin)
+                                                   : QCoreApplication::applicationDirPath() + "/slabrender-standin";
+    if(!QFileInfo(standin).isExecutable()) {
+        qCritical() << "Stand-in " << standin << " is not executable";
+        return 2;
+    }
+
+    // synthetic data set, one structure per folder
+    QTemporaryDir folder;
+    if(!folder.isValid()) {
+        qCritical() << "Could not create a temporary folder";
+        return 2;
+    }
+    auto start = std::chrono::steady_clock::now();
+    QStringList files;
+    for(int i=0; i<nr_jobs; i++) {
+        QString dir = QString("%1/%2").arg(folder.path()).arg(i, 6, 10, QChar('0'));
+        QDir().mkpath(dir);
+        write_poscar(dir + "/POSCAR", nr_atoms, i);
+        files << dir + "/POSCAR";
+    }
+    std::chrono::duration<double> setup_time = std::chrono::steady_clock::now() - start;
+
+    qputenv("SLABRENDER_STANDIN_TIME", QByteArray::number(job_time));
+    qputenv("SLABRENDER_STANDIN_MODE", parser.isSet(option_compute) ? "compute" : "sleep");
+
+    QMap<QString, QVariant> parameters = ThreadRenderImage::default_parameters();
+    parameters["nr_workers"] = nr_workers;
+    parameters["session_mode"] = parser.isSet(option_session);
+    parameters["resolution_x"] = 128;
+    parameters["resolution_y"] = 128;
+
+    ThreadRenderImage queue;
+    queue.set_executable(standin);
+    queue.set_parameters(parameters);
+    queue.set_files(files);
+    queue.set_data_folder(folder.path());
+
+    auto memory_start = read_memory();
+    int nr_done = 0;
+    int nr_failed = 0;
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_done, &app, [&](int) {
+        nr_done++;
+        if((nr_done + nr_failed) % std::max(1, nr_jobs / 10) == 0) {
+            auto memory = read_memory();
+            print_event("progress", {{"done", nr_done}, {"failed", nr_failed}, {"rss_kb", memory.first}});
+        }
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_failed, &app, [&](int) {
+        nr_failed++;
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_queue_done, &app, [&]() {
+        app.quit();
+    });
+
+    print_event("start", {{"jobs", nr_jobs}, {"atoms", nr_atoms}, {"workers", nr_workers}, {"job_time", job_time},
+                          {"session", parser.isSet(option_session)}, {"setup_time", setup_time.count()},
+                          {"rss_kb", memory_start.first}});
+    start = std::chrono::steady_clock::now();
+    queue.start();
+    app.exec();
+    queue.wait();
+    std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+    // the time a worker is occupied beyond the work of the stand-in
+    QJsonObject phases;
+    for(const QString& phase : ThreadRenderImage::get_timing_phases()) {
+        double total = 0.0;
+        for(int i=0; i<nr_jobs; i++) {
+            total += queue.get_timings(i).value(phase);
+        }
+        phases[phase] = total / nr_jobs;
+    }
+
+    auto memory_end = read_memory();
+    print_event("summary", {{"jobs", nr_jobs}, {"done", nr_done}, {"failed", nr_failed},
+                            {"wall_time", wall_time.count()},
+                            {"jobs_per_second", nr_done / wall_time.count()},
+                            {"overhead_per_job", wall_time.count() * nr_workers / nr_jobs - job_time},
+                            {"mean_phase_time", phases},
+                            {"rss_start_kb", memory_start.first}, {"rss_end_kb", memory_end.first},
+                            {"rss_peak_kb", memory_end.second},
+                            {"rss_growth_per_job_kb", (double)(memory_end.first - memory_start.first) / nr_jobs}});
+
+    return nr_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+/**
+ * Stand-in for Blender in the queue benchmark
+ *
+ * Accepts the command line SlabRender passes to Blender, reads the manifest
+ * and the atompack, spends a configurable amount of time and writes blank
+ * images of the requested size. Progress, timing and session markers mimic
+ * render_image.py, such that the queue handles the stand-in like Blender.
+ *
+ * SLABRENDER_STANDIN_TIME  seconds spent per job (default 0.1)
+ * SLABRENDER_STANDIN_MODE  "sleep" (default) or "compute" to keep a core busy
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(const Clock::time_point& start) {
+    std::chrono::duration<double> elapsed_seconds = Clock::now() - start;
+    return elapsed_seconds.count();
+}
+
+void print_line(const QString& line) {
+    std::fputs((line + "\n").toUtf8().constData(), stdout);
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Spend the configured time, reporting progress like Cycles does
+ */
+void render(double duration, bool compute, int samples) {
+    auto start = Clock::now();
+    const int nr_steps = 10;
+    volatile double sink = 0.0;
+    for(int step=1; step<=nr_steps; step++) {
+        double until = duration * step / nr_steps;
+        if(compute) {
+            while(seconds_since(start) < until) {
+                for(int i=0; i<10000; i++) {
+                    sink = sink + std::sqrt((double)i);
+                }
+            }
+        } else {
+            double remaining = until - seconds_since(start);
+            if(remaining > 0.0) {
+                QThread::usleep((unsigned long)(remaining * 1e6));
+            }
+        }
+
+        double left = std::max(0.0, duration - seconds_since(start));
+        print_line(QString("Fra:1 | Remaining:00:%1 | Sample %2/%3")
+                   .arg(left, 5, 'f', 2, QChar('0'))
+                   .arg(samples * step / nr_steps)
+                   .arg(samples));
+    }
+}
+
+/**
+ * @brief Render a single job, see render_image.py::render_job
+ */
+void render_job(const QString& manifest_path, const QString& atompack_path, const QString& output) {
+    print_line("SLABRENDER_JOB_START");
+    auto start = Clock::now();
+
+    QFile manifest_file(manifest_path);
+    if(!manifest_file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open " + manifest_path.toStdString());
+    }
+    QJsonParseError error;
+    QJsonObject data = QJsonDocument::fromJson(manifest_file.readAll(), &error).object();
+    if(error.error != QJsonParseError::NoError) {
+        throw std::runtime_error("Invalid manifest: " + error.errorString().toStdString());
+    }
+
+    // unit cell followed by the number of atoms
+    QFile atompack_file(atompack_path);
+    if(!atompack_file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open " + atompack_path.toStdString());
+    }
+    QByteArray atompack = atompack_file.readAll();
+    if(atompack.size() < (int)(9 * sizeof(double) + sizeof(uint32_t))) {
+        throw std::runtime_error("Truncated atompack " + atompack_path.toStdString());
+    }
+    double scene_build = seconds_since(start);
+
+    start = Clock::now();
+    double duration = qEnvironmentVariable("SLABRENDER_STANDIN_TIME", "0.1").toDouble();
+    bool compute = qEnvironmentVariable("SLABRENDER_STANDIN_MODE") == "compute";
+    render(duration, compute, data["samples"].toInt(128));
+
+    // bands are cropped to their border, views are stored as <output>_<name>.png
+    int width = data["resolution_x"].toInt(512);
+    int height = data["resolution_y"].toInt(512);
+    if(data.contains("border")) {
+        QJsonArray border = data["border"].toArray();
+        width = border[2].toInt() - border[0].toInt();
+        height = border[3].toInt() - border[1].toInt();
+    }
+
+    QStringList outputs;
+    QJsonArray views = data["views"].toArray();
+    QFileInfo info(output);
+    for(const QJsonValue& view : views) {
+        outputs << info.path() + "/" + info.completeBaseName() + "_" + view.toObject()["name"].toString() + ".png";
+    }
+    if(outputs.isEmpty()) {
+        outputs << output;
+    }
+
+    QImage image(std::max(1, width), std::max(1, height), QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    for(const QString& path : outputs) {
+        if(!image.save(path, "PNG")) {
+            throw std::runtime_error("Could not write " + path.toStdString());
+        }
+    }
+
+    print_line(QString("SLABRENDER_TIMING scene_build %1").arg(scene_build, 0, 'f', 6));
+    print_line(QString("SLABRENDER_TIMING render %1").arg(seconds_since(start), 0, 'f', 6));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QStringList arguments = app.arguments();
+    int separator = arguments.indexOf("--");
+    if(separator < 0 || separator + 1 >= arguments.size()) {
+        std::cerr << "Usage: slabrender-standin [blender options] -- (manifest atompack output | --session)" << std::endl;
+        return 2;
+    }
+    arguments = arguments.mid(separator + 1);
+
+    // resident session receiving its jobs over stdin, see render_image.py::run_session
+    if(arguments[0] == "--session") {
+        print_line("SLABRENDER_SESSION_READY");
+        std::string line;
+        while(std::getline(std::cin, line)) {
+            QJsonObject job = QJsonDocument::fromJson(QByteArray::fromStdString(line)).object();
+            if(job.isEmpty()) {
+                continue;
+            }
+
+            try {
+                render_job(job["manifest"].toString(), job["atompack"].toString(), job["output"].toString());
+                print_line("SLABRENDER_JOB_DONE ok");
+            } catch (const std::exception& e) {
+                print_line(QString("SLABRENDER_JOB_DONE error %1").arg(e.what()));
+            }
+        }
+        return 0;
+    }
+
+    if(arguments.size() < 3) {
+        std::cerr << "Expected a manifest, an atompack and an output path" << std::endl;
+        return 2;
+    }
+
+    try {
+        render_job(arguments[0], arguments[1], arguments[2]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,6 +5,7 @@ set -euo pipefail
 # Configuration
 # ------------------------------------------------------------
 APP_NAME="slabrender"
+CLI_NAME="slabrender-cli"
 BUILD_DIR="build-windows"
 DIST_DIR="dist"
 INSTALLER_DIR="installer"
@@ -32,10 +33,17 @@ echo "==> Building"
 cmake --build "${BUILD_DIR}"
 
 # ------------------------------------------------------------
-# Copy executable
+# Test
 # ------------------------------------------------------------
-echo "==> Copying executable"
+echo "==> Running unit tests"
+ctest --test-dir "${BUILD_DIR}" --output-on-failure
+
+# ------------------------------------------------------------
+# Copy executables
+# ------------------------------------------------------------
+echo "==> Copying executables"
 cp "${BUILD_DIR}/${APP_NAME}.exe" "${DIST_DIR}/"
+cp "${BUILD_DIR}/${CLI_NAME}.exe" "${DIST_DIR}/"
 
 # Provide qmake.exe for windeployqt (MSYS2 requirement)
 QMAKE_QT5="$MINGW_PREFIX/bin/qmake-qt5.exe"
@@ -55,14 +63,15 @@ windeployqt-qt5 \
   --no-opengl-sw \
   --no-translations \
   --no-compiler-runtime \
-  "${DIST_DIR}/${APP_NAME}.exe"
+  "${DIST_DIR}/${APP_NAME}.exe" \
+  "${DIST_DIR}/${CLI_NAME}.exe"
 
 # ------------------------------------------------------------
-# Optional: strip binary (smaller installer)
+# Optional: strip binaries (smaller installer)
 # ------------------------------------------------------------
-strip "${DIST_DIR}/${APP_NAME}.exe" || true
+strip "${DIST_DIR}/${APP_NAME}.exe" "${DIST_DIR}/${CLI_NAME}.exe" || true
 
-ldd "${DIST_DIR}/${APP_NAME}" | awk '{print $3}' | while read -r path; do
+ldd "${DIST_DIR}/${APP_NAME}.exe" "${DIST_DIR}/${CLI_NAME}.exe" | awk '{print $3}' | sort -u | while read -r path; do
   case "$path" in
     /mingw64/bin/*.dll)
       dll="$(basename "$path")"
@@ -0,0 +1,142 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include "atom_style.h"
+
+/**
+ * @brief Constructs a new instance
+ * @param custom_json   key-value pairs as entered in the settings panel,
+ *                      possibly with a trailing comma
+ */
+AtomStyle::AtomStyle(const QString& custom_json) {
+    QString snippet = custom_json.trimmed();
+    if(snippet.endsWith(',')) {
+        snippet.chop(1);
+    }
+    if(snippet.isEmpty()) {
+        return;
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(("{" + snippet + "}").toUtf8(), &error);
+    if(error.error != QJsonParseError::NoError) {
+        qWarning() << "Ignoring atom_colors and atom_radii, invalid custom JSON: " << error.errorString();
+        return;
+    }
+
+    this->radius_directives = parse_directives<float>(doc.object(), "atom_radii", &AtomStyle::parse_radius);
+    this->color_directives = parse_directives<Color>(doc.object(), "atom_colors", &AtomStyle::parse_color);
+}
+
+/**
+ * @brief Radius of an atom in angstrom
+ * @param elnr      element number
+ * @param index     0-based index of the atom in the structure
+ */
+float AtomStyle::get_radius(unsigned int elnr, size_t index) const {
+    for(auto it = this->radius_directives.crbegin(); it != this->radius_directives.crend(); ++it) {
+        if(matches(*it, elnr, index)) {
+            return it->value;
+        }
+    }
+
+    return AtomSettings::get().get_atom_radius_from_elnr(elnr);
+}
+
+/**
+ * @brief Color of an atom as 8-bit RGB
+ * @param elnr      element number
+ * @param index     0-based index of the atom in the structure
+ */
+AtomStyle::Color AtomStyle::get_color(unsigned int elnr, size_t index) const {
+    for(auto it = this->color_directives.crbegin(); it != this->color_directives.crend(); ++it) {
+        if(matches(*it, elnr, index)) {
+            return it->value;
+        }
+    }
+
+    // the defaults are stored as 8-bit values divided by 255
+    const QVector3D& color = AtomSettings::get().get_atom_color_from_elnr(elnr);
+    return {(uint8_t)std::lround(color[0] * 255.f), (uint8_t)std::lround(color[1] * 255.f), (uint8_t)std::lround(color[2] * 255.f)};
+}
+
+/**
+ * @brief Parse the directives of a key, skipping invalid entries
+ */
+template<typename T>
+QVector<AtomStyle::Directive<T>> AtomStyle::parse_directives(const QJsonObject& root, const QString& key,
+                                                             bool (*parse_value)(const QString&, T&)) {
+    QVector<Directive<T>> directives;
+    for(const QJsonValue& item : root.value(key).toArray()) {
+        QStringList pieces = item.toString().split('/');
+        Directive<T> directive;
+        bool ok_first = false;
+        bool ok_last = false;
+        if(pieces.size() == 4) {
+            directive.first = pieces[1].toInt(&ok_first);
+            directive.last = pieces[2].toInt(&ok_last);
+        }
+        if(!ok_first || !ok_last || !parse_value(pieces.last(), directive.value)) {
+            qWarning() << "Ignoring invalid " << key << " entry " << item.toString();
+            continue;
+        }
+
+        try {
+            directive.elnr = AtomSettings::get().get_atom_elnr(pieces[0].toStdString());
+        } catch (const std::exception&) {
+            qWarning() << "Ignoring " << key << " entry " << item.toString() << " for unknown element";
+            continue;
+        }
+
+        directives.append(directive);
+    }
+
+    return directives;
+}
+
+bool AtomStyle::parse_radius(const QString& str, float& radius) {
+    bool ok = false;
+    radius = str.toFloat(&ok);
+    return ok && radius > 0.f;
+}
+
+/**
+ * @brief Parse a hex code with or without leading #, e.g. #ff0000
+ */
+bool AtomStyle::parse_color(const QString& str, Color& color) {
+    QString hexcode = str.trimmed();
+    if(hexcode.startsWith('#')) {
+        hexcode.remove(0, 1);
+    }
+    if(hexcode.size() != 6) {
+        return false;
+    }
+
+    for(int i=0; i<3; i++) {
+        bool ok = false;
+        color[i] = hexcode.mid(i * 2, 2).toUInt(&ok, 16);
+        if(!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,116 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#ifndef ATOMSTYLE_H
+#define ATOMSTYLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QVector3D>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "atom_settings.h"
+
+/**
+ * @brief Radius and color of every atom, including the custom directives
+ *
+ * The atom_colors and atom_radii directives of the custom JSON snippet
+ * ("element/first/last/value" with 1-based atom indices, or 0/0 for all
+ * atoms of the element) are parsed once. The last matching directive wins;
+ * atoms without a matching directive take the defaults of AtomSettings. Both
+ * the atompack and the structure preview use this class, such that overrides
+ * look the same in both.
+ */
+class AtomStyle {
+public:
+    typedef std::array<uint8_t, 3> Color;
+
+private:
+    template<typename T>
+    struct Directive {
+        unsigned int elnr;
+        int first;              // 1-based index of the first atom, 0 for all atoms
+        int last;               // 1-based index of the last atom, 0 for all atoms
+        T value;
+    };
+
+    QVector<Directive<float>> radius_directives;
+    QVector<Directive<Color>> color_directives;
+
+public:
+    /**
+     * @brief Constructs a new instance
+     * @param custom_json   key-value pairs as entered in the settings panel,
+     *                      possibly with a trailing comma
+     */
+    AtomStyle(const QString& custom_json = QString());
+
+    /**
+     * @brief Radius of an atom in angstrom
+     * @param elnr      element number
+     * @param index     0-based index of the atom in the structure
+     */
+    float get_radius(unsigned int elnr, size_t index) const;
+
+    /**
+     * @brief Color of an atom as 8-bit RGB
+     * @param elnr      element number
+     * @param index     0-based index of the atom in the structure
+     */
+    Color get_color(unsigned int elnr, size_t index) const;
+
+    /**
+     * @brief Color of an atom with components between 0 and 1
+     */
+    inline QVector3D get_color_vector(unsigned int elnr, size_t index) const {
+        Color color = this->get_color(elnr, index);
+        return QVector3D(color[0], color[1], color[2]) / 255.f;
+    }
+
+private:
+    /**
+     * @brief Parse the directives of a key, skipping invalid entries
+     */
+    template<typename T>
+    static QVector<Directive<T>> parse_directives(const QJsonObject& root, const QString& key,
+                                                  bool (*parse_value)(const QString&, T&));
+
+    template<typename T>
+    static bool matches(const Directive<T>& directive, unsigned int elnr, size_t index) {
+        return directive.elnr == elnr &&
+               ((directive.first == 0 && directive.last == 0) ||
+                ((int)index + 1 >= directive.first && (int)index + 1 <= directive.last));
+    }
+
+    static bool parse_radius(const QString& str, float& radius);
+
+    static bool parse_color(const QString& str, Color& color);
+};
+
+#endif // ATOMSTYLE_H
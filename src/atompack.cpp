@@ -0,0 +1,58 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include "atompack.h"
+
+/**
+ * @brief Write the atompack, replacing an existing file in a single step
+ *
+ * Replacing rather than overwriting also leaves the hardlinks in job folders
+ * of running jobs intact.
+ */
+void AtomPackWriter::write(const QString& path) const {
+    // header, column table, columns
+    QByteArray out;
+    out.append(MAGIC, 8);
+    const uint32_t nr_columns = this->columns.size();
+    out.append(reinterpret_cast<const char*>(&VERSION), sizeof(uint32_t));
+    out.append(reinterpret_cast<const char*>(&nr_columns), sizeof(uint32_t));
+
+    // name, type string, width, offset and rows; 48 bytes per column
+    uint64_t offset = align(out.size() + nr_columns * (NAME_LENGTH + 4 + sizeof(uint32_t) + 2 * sizeof(uint64_t)));
+    for(const Column& column : this->columns) {
+        out.append(column.name.leftJustified(NAME_LENGTH, '\0'));
+        out.append(column.dtype.leftJustified(4, '\0'));
+        out.append(reinterpret_cast<const char*>(&column.width), sizeof(uint32_t));
+        out.append(reinterpret_cast<const char*>(&offset), sizeof(uint64_t));
+        out.append(reinterpret_cast<const char*>(&column.rows), sizeof(uint64_t));
+        offset = align(offset + column.data.size());
+    }
+
+    for(const Column& column : this->columns) {
+        out.append(QByteArray(align(out.size()) - out.size(), '\0'));
+        out.append(column.data);
+    }
+
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        throw std::runtime_error("Could not write " + path.toStdString());
+    }
+}
@@ -0,0 +1,114 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#ifndef ATOMPACK_H
+#define ATOMPACK_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QSaveFile>
+#include <QSysInfo>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * @brief Writer of the version 2 atompack, the structure passed to Blender
+ *
+ * A version 2 atompack starts with the magic "ATOMPACK", the version and the
+ * number of columns, followed by a table that lists per column its name, its
+ * numpy type string (e.g. "<f8"), its width, its offset and its number of
+ * rows. Every column is stored contiguously (structure of arrays) and starts
+ * at a multiple of 8 bytes, such that render_image.py can read it with a
+ * single numpy.frombuffer call. Readers look up columns by name and ignore
+ * unknown ones, hence columns can be added without changing the version.
+ *
+ * Version 1 atompacks lack the magic and store interleaved, unaligned records;
+ * render_image.py reads both.
+ */
+class AtomPackWriter {
+private:
+    struct Column {
+        QByteArray name;
+        QByteArray dtype;       // numpy type string
+        uint32_t width;         // values per row
+        uint64_t rows;
+        QByteArray data;
+    };
+
+    QVector<Column> columns;
+
+public:
+    static constexpr const char* MAGIC = "ATOMPACK";
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t ALIGNMENT = 8;
+    static constexpr size_t NAME_LENGTH = 24;
+
+    /**
+     * @brief Add a column
+     * @param name      name of the column, at most 24 characters
+     * @param values    row-major values
+     * @param width     number of values per row
+     */
+    template<typename T>
+    void add_column(const char* name, const std::vector<T>& values, uint32_t width = 1) {
+        if(std::strlen(name) > NAME_LENGTH || width == 0 || values.size() % width != 0) {
+            throw std::logic_error(std::string("Invalid atompack column ") + name);
+        }
+
+        Column column;
+        column.name = QByteArray(name);
+        column.dtype = get_dtype<T>();
+        column.width = width;
+        column.rows = values.size() / width;
+        column.data = QByteArray(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        this->columns.append(column);
+    }
+
+    /**
+     * @brief Write the atompack, replacing an existing file in a single step
+     */
+    void write(const QString& path) const;
+
+private:
+    template<typename T>
+    static QByteArray get_dtype() {
+        QByteArray order = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "<" : ">";
+        if constexpr(std::is_same_v<T, double>) {
+            return order + "f8";
+        } else if constexpr(std::is_same_v<T, uint32_t>) {
+            return order + "u4";
+        } else {
+            static_assert(std::is_same_v<T, uint8_t>, "Unsupported atompack column type");
+            return "|u1";
+        }
+    }
+
+    static size_t align(size_t offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+};
+
+#endif // ATOMPACK_H
@@ -0,0 +1,138 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include "cost_model.h"
+
+/**
+ * @brief Constructs a new instance and reads the timing history
+ * @param _filename history file; empty for the default location
+ */
+CostModel::CostModel(const QString& _filename) :
+    filename(_filename.isEmpty() ? CostModel::default_location() : _filename) {
+
+    QFile file(this->filename);
+    if(file.open(QIODevice::ReadOnly)) {
+        QJsonArray entries = QJsonDocument::fromJson(file.readAll()).array();
+        for(const QJsonValue& value : entries) {
+            QJsonObject entry = value.toObject();
+            JobFeatures features;
+            features.nr_atoms = entry["nr_atoms"].toDouble();
+            features.nr_bonds = entry["nr_bonds"].toDouble();
+            features.pixels = entry["pixels"].toDouble();
+            features.samples = entry["samples"].toDouble();
+            this->history.emplace_back(features, entry["time"].toDouble());
+        }
+
+        while(this->history.size() > MAX_HISTORY) {
+            this->history.pop_front();
+        }
+        qDebug() << "Read " << this->history.size() << " timings from " << this->filename;
+    }
+
+    this->fit();
+}
+
+/**
+ * @brief Default location of the timing history
+ */
+QString CostModel::default_location() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/" + PROGRAM_NAME_LC + "/render_timings.json";
+}
+
+/**
+ * @brief Predicted render time of a job in seconds
+ */
+double CostModel::predict(const JobFeatures& features) const {
+    // a job never takes less than launching Blender
+    return std::max(1.0, build_feature_vector(features).dot(this->coefficients));
+}
+
+/**
+ * @brief Record the render time of a job and refit the model
+ */
+void CostModel::add_sample(const JobFeatures& features, double process_time) {
+    this->history.emplace_back(features, process_time);
+    if(this->history.size() > MAX_HISTORY) {
+        this->history.pop_front();
+    }
+
+    this->fit();
+}
+
+/**
+ * @brief Write the timing history to file
+ */
+void CostModel::save() const {
+    QJsonArray entries;
+    for(const auto& sample : this->history) {
+        entries.append(QJsonObject{{"nr_atoms", sample.first.nr_atoms},
+                                   {"nr_bonds", sample.first.nr_bonds},
+                                   {"pixels", sample.first.pixels},
+                                   {"samples", sample.first.samples},
+                                   {"time", sample.second}});
+    }
+
+    // concurrent runs may share the history; never leave a partially written file
+    QDir().mkpath(QFileInfo(this->filename).absolutePath());
+    QSaveFile file(this->filename);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write render timings to " << this->filename;
+        return;
+    }
+    file.write(QJsonDocument(entries).toJson(QJsonDocument::Compact));
+    if(!file.commit()) {
+        qWarning() << "Could not write render timings to " << this->filename;
+    }
+}
+
+CostModel::VectorFeatures CostModel::build_feature_vector(const JobFeatures& features) {
+    double nr_objects = features.nr_atoms + features.nr_bonds;
+    double gigasamples = features.pixels * features.samples * 1e-9;
+
+    VectorFeatures x;
+    x << 1.0, nr_objects, gigasamples, gigasamples * std::log1p(nr_objects);
+    return x;
+}
+
+/**
+ * @brief Regularized least squares fit of the coefficients
+ *
+ * Solves (X^T X + D) b = X^T y + D b0, where b0 holds the prior coefficients
+ * and D weighs the deviation from the prior by the typical magnitude of
+ * each feature, i.e. the prior counts as roughly a single observation.
+ */
+void CostModel::fit() {
+    // startup (s), per object (s), per 10^9 pixel samples (s), BVH term (s)
+    VectorFeatures prior;
+    prior << 5.0, 0.02, 20.0, 5.0;
+
+    VectorFeatures scale;
+    scale << 1.0, 1000.0, 0.05, 0.3;
+    Eigen::Matrix<double, NR_FEATURES, NR_FEATURES> lhs = scale.cwiseAbs2().asDiagonal();
+    VectorFeatures rhs = lhs * prior;
+
+    for(const auto& sample : this->history) {
+        VectorFeatures x = build_feature_vector(sample.first);
+        lhs += x * x.transpose();
+        rhs += x * sample.second;
+    }
+
+    this->coefficients = lhs.ldlt().solve(rhs);
+}
@@ -0,0 +1,111 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <QString>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+#include "config.h"
+
+/**
+ * @brief Properties of a render job that determine its cost
+ */
+struct JobFeatures {
+    double nr_atoms = 0.0;      // including the atoms of the unit cell expansion
+    double nr_bonds = 0.0;      // including the bonds of the unit cell expansion
+    double pixels = 0.0;        // number of pixels of the image
+    double samples = 0.0;       // samples per pixel
+};
+
+/**
+ * @brief Predicts the render time of a job
+ *
+ * The render time is modelled as a linear combination of a constant startup
+ * cost, the number of scene objects (atoms and bonds), the number of pixel
+ * samples and the pixel samples weighted by the logarithm of the number of
+ * objects (BVH traversal). The coefficients are fitted by least squares
+ * against the timings of earlier jobs, which are kept in a history file
+ * shared between runs. The fit is regularized towards a conservative prior
+ * such that predictions are sensible before any timing is recorded.
+ */
+class CostModel {
+private:
+    static const int NR_FEATURES = 4;
+    static const size_t MAX_HISTORY = 1000;     // most recent timings kept in the history
+
+    typedef Eigen::Matrix<double, NR_FEATURES, 1> VectorFeatures;
+
+    QString filename;
+    std::deque<std::pair<JobFeatures, double>> history;
+    VectorFeatures coefficients;
+
+public:
+    /**
+     * @brief Constructs a new instance and reads the timing history
+     * @param _filename history file; empty for the default location
+     */
+    CostModel(const QString& _filename = QString());
+
+    /**
+     * @brief Default location of the timing history
+     */
+    static QString default_location();
+
+    /**
+     * @brief Predicted render time of a job in seconds
+     */
+    double predict(const JobFeatures& features) const;
+
+    /**
+     * @brief Record the render time of a job and refit the model
+     */
+    void add_sample(const JobFeatures& features, double process_time);
+
+    /**
+     * @brief Write the timing history to file
+     */
+    void save() const;
+
+    inline size_t get_nr_samples() const {
+        return this->history.size();
+    }
+
+private:
+    static VectorFeatures build_feature_vector(const JobFeatures& features);
+
+    void fit();
+};
+
+#endif // COSTMODEL_H
@@ -0,0 +1,133 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include "cpu_affinity.h"
+
+/**
+ * @brief Cores this process is allowed to run on
+ */
+QVector<int> CpuAffinity::available_cpus() {
+    QVector<int> cpus;
+
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for(int i=0; i<CPU_SETSIZE; i++) {
+            if(CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+#endif
+
+    if(cpus.isEmpty()) {
+        for(int i=0; i<std::max(1, QThread::idealThreadCount()); i++) {
+            cpus.push_back(i);
+        }
+    }
+
+    return cpus;
+}
+
+/**
+ * @brief Divide the available cores over the workers
+ * @param nr_workers        number of concurrent Blender processes
+ * @param threads           threads per worker; zero to divide the cores evenly
+ * @return set of cores per worker; empty sets when the cores cannot be divided
+ */
+QVector<QVector<int>> CpuAffinity::partition(int nr_workers, int threads) {
+    return partition(available_cpus(), nr_workers, threads);
+}
+
+/**
+ * @brief Divide a set of cores over the workers
+ */
+QVector<QVector<int>> CpuAffinity::partition(const QVector<int>& cpus, int nr_workers, int threads) {
+    QVector<QVector<int>> sets(nr_workers);
+
+    if(threads <= 0) {
+        threads = std::max(1, (int)cpus.size() / std::max(1, nr_workers));
+    }
+
+    if(threads * nr_workers > cpus.size()) {
+        qWarning() << nr_workers << " workers with " << threads << " threads exceed the "
+                   << cpus.size() << " available cores, workers are not pinned";
+        return sets;
+    }
+
+    for(int i=0; i<nr_workers; i++) {
+        sets[i] = cpus.mid(i * threads, threads);
+    }
+
+    return sets;
+}
+
+/**
+ * @brief Human readable form of a set of cores, e.g. "0-3,8"
+ */
+QString CpuAffinity::to_string(const QVector<int>& cpus) {
+    QStringList ranges;
+    for(int i=0; i<cpus.size(); ) {
+        int j = i;
+        while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            j++;
+        }
+        ranges << (i == j ? QString::number(cpus[i]) : QString("%1-%2").arg(cpus[i]).arg(cpus[j]));
+        i = j + 1;
+    }
+
+    return ranges.join(",");
+}
+
+PinnedProcess::PinnedProcess(const QVector<int>& _cpus, QObject* parent) :
+    QProcess(parent),
+    cpus(_cpus) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    this->setChildProcessModifier([this]() {
+        this->apply_affinity();
+    });
+#endif
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+void PinnedProcess::setupChildProcess() {
+    this->apply_affinity();
+}
+#endif
+
+/**
+ * @brief Apply the affinity to the calling process; only async-signal-safe calls
+ */
+void PinnedProcess::apply_affinity() const {
+#ifdef Q_OS_LINUX
+    if(this->cpus.isEmpty()) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : this->cpus) {
+        CPU_SET(cpu, &set);
+    }
+    ::sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
@@ -0,0 +1,104 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#ifndef CPUAFFINITY_H
+#define CPUAFFINITY_H
+
+#include <QProcess>
+#include <QThread>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QDebug>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+/**
+ * @brief Division of the CPU cores over the concurrently running Blender processes
+ *
+ * Every Blender process starts as many render threads as there are cores,
+ * such that concurrent CPU renders oversubscribe the machine. Each worker
+ * therefore receives a thread budget and, where supported (Linux), a
+ * disjoint set of cores its process is pinned to. Only the cores this
+ * process may run on are considered, which respects the allocation of a
+ * batch scheduler.
+ */
+class CpuAffinity {
+public:
+    /**
+     * @brief Cores this process is allowed to run on
+     */
+    static QVector<int> available_cpus();
+
+    /**
+     * @brief Divide the available cores over the workers
+     * @param nr_workers        number of concurrent Blender processes
+     * @param threads           threads per worker; zero to divide the cores evenly
+     * @return set of cores per worker; empty sets when the cores cannot be divided
+     */
+    static QVector<QVector<int>> partition(int nr_workers, int threads);
+
+    /**
+     * @brief Divide a set of cores over the workers
+     * @param cpus              cores to divide
+     * @param nr_workers        number of concurrent Blender processes
+     * @param threads           threads per worker; zero to divide the cores evenly
+     * @return set of cores per worker; empty sets when the cores cannot be divided
+     */
+    static QVector<QVector<int>> partition(const QVector<int>& cpus, int nr_workers, int threads);
+
+    /**
+     * @brief Human readable form of a set of cores, e.g. "0-3,8"
+     */
+    static QString to_string(const QVector<int>& cpus);
+};
+
+/**
+ * @brief Process that restricts itself to a set of cores before it executes the program
+ *
+ * The affinity is set in the child between fork and exec, such that all
+ * threads of the program inherit it. Without a set of cores, or on
+ * platforms other than Linux, this is a plain QProcess.
+ */
+class PinnedProcess : public QProcess {
+private:
+    QVector<int> cpus;
+
+public:
+    explicit PinnedProcess(const QVector<int>& _cpus = QVector<int>(), QObject* parent = nullptr);
+
+protected:
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    void setupChildProcess() override;
+#endif
+
+private:
+    /**
+     * @brief Apply the affinity to the calling process; only async-signal-safe calls
+     */
+    void apply_affinity() const;
+};
+
+#endif // CPUAFFINITY_H
@@ -0,0 +1,303 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include "job_lease.h"
+
+/**
+ * @brief Constructs a new instance
+ * @param file      structure file of the job
+ * @param _owner    identifier of this instance (see instance_id)
+ * @param _timeout  validity of the lease in seconds
+ */
+JobLease::JobLease(const QString& file, const QString& _owner, int _timeout) :
+    path(JobLease::get_lease_path(file)),
+    owner(_owner),
+    timeout(_timeout) {
+}
+
+JobLease::~JobLease() {
+    this->release();
+}
+
+/**
+ * @brief Unique identifier of this instance: host, process id and a random tag
+ */
+QString JobLease::instance_id() {
+    static const QString id = QString("%1:%2:%3").arg(QSysInfo::machineHostName())
+                                                 .arg(QCoreApplication::applicationPid())
+                                                 .arg(QUuid::createUuid().toString(QUuid::WithoutBraces).left(8));
+    return id;
+}
+
+/**
+ * @brief Claim the job, reclaiming an expired lease of another instance
+ * @return whether the lease is held by this instance
+ */
+bool JobLease::acquire() {
+    // a second attempt is only made after an expired lease has been reclaimed
+    for(int attempt=0; attempt<2; attempt++) {
+        QFile file(this->path);
+        if(file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+            file.write(this->build_contents());
+            file.flush();
+#ifdef Q_OS_UNIX
+            ::fsync(file.handle());
+#endif
+            this->held = true;
+            this->observed_since.invalidate();
+            return true;
+        }
+
+        if(!file.exists() || !this->is_expired(this->path) || !this->reclaim()) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Extend the lease
+ * @return false when the lease has been taken over by another instance
+ */
+bool JobLease::heartbeat() {
+    if(!this->held) {
+        return false;
+    }
+
+    if(read_json(this->path)["owner"].toString() != this->owner) {
+        qWarning() << "Lease " << this->path << " has been taken over by another instance";
+        this->held = false;
+        return false;
+    }
+
+    // replace the lease in a single step such that readers never see a partial file
+    QSaveFile file(this->path);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not extend lease " << this->path;
+        return true;
+    }
+    file.write(this->build_contents());
+    if(!file.commit()) {
+        qWarning() << "Could not extend lease " << this->path;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Give up the lease
+ */
+void JobLease::release() {
+    if(!this->held) {
+        return;
+    }
+
+    // never remove a lease that has been reclaimed by another instance
+    if(read_json(this->path)["owner"].toString() == this->owner) {
+        QFile::remove(this->path);
+    }
+    this->held = false;
+}
+
+/**
+ * @brief Owner recorded in the lease of a structure file, empty when unclaimed
+ */
+QString JobLease::get_owner(const QString& file) {
+    return read_json(get_lease_path(file))["owner"].toString();
+}
+
+/**
+ * @brief Mark the job of a structure file as completed
+ * @param file      structure file of the job
+ * @param data      identification of the rendered input
+ */
+void JobLease::mark_done(const QString& file, const QJsonObject& data) {
+    QJsonObject contents = data;
+    contents["owner"] = instance_id();
+    contents["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+
+    QSaveFile out(get_done_path(file));
+    if(!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not mark " << file << " as completed";
+        return;
+    }
+    out.write(QJsonDocument(contents).toJson(QJsonDocument::Compact));
+    if(!out.commit()) {
+        qWarning() << "Could not mark " << file << " as completed";
+    }
+}
+
+/**
+ * @brief Contents of the done file of a structure file, empty when the job is not completed
+ */
+QJsonObject JobLease::read_done(const QString& file) {
+    return read_json(get_done_path(file));
+}
+
+/**
+ * @brief Path of the lease of a structure file, e.g. .POSCAR.slabrender.lease
+ *
+ * The leading dot hides the file and keeps it from matching the patterns
+ * structure files are searched with.
+ */
+QString JobLease::get_lease_path(const QString& file) {
+    QFileInfo info(file);
+    return info.absolutePath() + "/." + info.fileName() + LEASE_SUFFIX;
+}
+
+/**
+ * @brief Path of the done file of a structure file, e.g. .POSCAR.slabrender.done
+ */
+QString JobLease::get_done_path(const QString& file) {
+    QFileInfo info(file);
+    return info.absolutePath() + "/." + info.fileName() + DONE_SUFFIX;
+}
+
+QByteArray JobLease::build_contents() const {
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    QJsonObject contents;
+    contents["owner"] = this->owner;
+    contents["heartbeat"] = now.toString(Qt::ISODateWithMs);
+    contents["expires"] = now.addSecs(this->timeout).toString(Qt::ISODateWithMs);
+
+    return QJsonDocument(contents).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief Whether the lease file at a path has been observed unchanged for the timeout
+ *
+ * Every heartbeat changes the contents of the lease. The time since the
+ * contents last changed is measured on the monotonic clock of this instance,
+ * such that neither the clocks of other hosts nor the modification times set
+ * by the file server are involved. A lease seen for the first time is
+ * therefore never expired.
+ */
+bool JobLease::is_expired(const QString& filename) {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray contents = file.readAll();
+    if(!this->observed_since.isValid() || contents != this->observed) {
+        this->observed = contents;
+        this->observed_since.start();
+        return false;
+    }
+
+    return this->observed_since.elapsed() >= (qint64)this->timeout * 1000;
+}
+
+/**
+ * @brief Move an expired lease out of the way
+ * @return whether the expired lease was removed by this instance
+ */
+bool JobLease::reclaim() {
+    QString stale_path = this->path + ".stale-" + QUuid::createUuid().toString(QUuid::WithoutBraces);
+    if(!QFile::rename(this->path, stale_path)) {
+        // another instance was first
+        return false;
+    }
+
+    // the owner may have extended the lease in the meantime, put it back
+    if(!this->is_expired(stale_path)) {
+        if(!QFile::rename(stale_path, this->path)) {
+            QFile::remove(stale_path);
+        }
+        return false;
+    }
+
+    qWarning() << "Reclaiming expired lease of " << read_json(stale_path)["owner"].toString() << " on " << this->path;
+    QFile::remove(stale_path);
+    return true;
+}
+
+QJsonObject JobLease::read_json(const QString& filename) {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+/**
+ * @brief Constructs a new instance; call start() to send heartbeats
+ * @param _interval time between heartbeats in milliseconds
+ */
+LeaseKeeper::LeaseKeeper(int _interval) :
+    interval(_interval) {
+}
+
+LeaseKeeper::~LeaseKeeper() {
+    this->stop();
+}
+
+/**
+ * @brief Send heartbeats for a lease held by this instance
+ */
+void LeaseKeeper::insert(int jobid, const std::shared_ptr<JobLease>& lease) {
+    QMutexLocker lock(&this->mutex);
+    this->leases[jobid] = lease;
+}
+
+/**
+ * @brief Stop sending heartbeats for a lease
+ * @return the lease, null when no lease is kept for the job
+ */
+std::shared_ptr<JobLease> LeaseKeeper::take(int jobid) {
+    // waits for a heartbeat in progress, such that the caller can release the lease
+    QMutexLocker lock(&this->mutex);
+    return this->leases.take(jobid);
+}
+
+/**
+ * @brief Stop the thread, keeping the leases
+ */
+void LeaseKeeper::stop() {
+    {
+        QMutexLocker lock(&this->mutex);
+        this->stopping = true;
+        this->condition.wakeAll();
+    }
+    this->wait();
+}
+
+void LeaseKeeper::run() {
+    QMutexLocker lock(&this->mutex);
+    while(!this->stopping) {
+        if(this->condition.wait(&this->mutex, this->interval)) {
+            continue;   // woken up by stop()
+        }
+
+        for(auto it = this->leases.begin(); it != this->leases.end(); ) {
+            if(it.value()->heartbeat()) {
+                ++it;
+                continue;
+            }
+
+            // the job is rendered by the instance that reclaimed the lease
+            int jobid = it.key();
+            it = this->leases.erase(it);
+            emit(signal_lease_lost(jobid));
+        }
+    }
+}
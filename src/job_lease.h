@@ -0,0 +1,208 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#ifndef JOBLEASE_H
+#define JOBLEASE_H
+
+#include <QString>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QSysInfo>
+#include <QUuid>
+#include <QCoreApplication>
+#include <QHash>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QDebug>
+
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Claim on a render job shared between instances via the file system
+ *
+ * Instances that work through the same (network) folder claim a job by
+ * exclusively creating a hidden lease file next to the structure file, such
+ * that structures sharing a folder are claimed independently. The owner
+ * rewrites the lease periodically via heartbeat(). Clocks of different hosts
+ * need not agree: an instance considers a lease expired once it has observed
+ * the lease unchanged for the timeout on its own monotonic clock. An expired
+ * lease belongs to a dead instance and is reclaimed by renaming it out of the
+ * way; as rename is atomic, only a single instance succeeds. Completed jobs
+ * are marked with a done file that holds the key of the rendered input.
+ *
+ * Only exclusive creation and atomic rename are required of the file system.
+ * Duplicate work after a falsely expired lease is possible but harmless, as
+ * images are published with an atomic rename.
+ */
+class JobLease {
+private:
+    QString path;           // path to the lease file
+    QString owner;          // identifier of this instance
+    int timeout;            // validity of the lease in seconds after the last heartbeat
+    bool held = false;
+
+    QByteArray observed;            // contents of the lease of another instance when last read
+    QElapsedTimer observed_since;   // time since the contents were last seen to change
+
+public:
+    static constexpr const char* LEASE_SUFFIX = ".slabrender.lease";
+    static constexpr const char* DONE_SUFFIX = ".slabrender.done";
+
+    /**
+     * @brief Constructs a new instance
+     * @param file      structure file of the job
+     * @param _owner    identifier of this instance (see instance_id)
+     * @param _timeout  validity of the lease in seconds
+     */
+    JobLease(const QString& file, const QString& _owner, int _timeout);
+
+    ~JobLease();
+
+    /**
+     * @brief Unique identifier of this instance: host, process id and a random tag
+     */
+    static QString instance_id();
+
+    /**
+     * @brief Claim the job, reclaiming an expired lease of another instance
+     * @return whether the lease is held by this instance
+     */
+    bool acquire();
+
+    /**
+     * @brief Extend the lease
+     * @return false when the lease has been taken over by another instance
+     */
+    bool heartbeat();
+
+    /**
+     * @brief Give up the lease
+     */
+    void release();
+
+    /**
+     * @brief Owner recorded in the lease of a structure file, empty when unclaimed
+     */
+    static QString get_owner(const QString& file);
+
+    /**
+     * @brief Mark the job of a structure file as completed
+     * @param file      structure file of the job
+     * @param data      identification of the rendered input
+     */
+    static void mark_done(const QString& file, const QJsonObject& data);
+
+    /**
+     * @brief Contents of the done file of a structure file, empty when the job is not completed
+     */
+    static QJsonObject read_done(const QString& file);
+
+    /**
+     * @brief Path of the lease of a structure file, e.g. .POSCAR.slabrender.lease
+     */
+    static QString get_lease_path(const QString& file);
+
+    /**
+     * @brief Path of the done file of a structure file, e.g. .POSCAR.slabrender.done
+     */
+    static QString get_done_path(const QString& file);
+
+private:
+    QByteArray build_contents() const;
+
+    /**
+     * @brief Whether the lease file at a path has been observed unchanged for the timeout
+     */
+    bool is_expired(const QString& filename);
+
+    /**
+     * @brief Move an expired lease out of the way
+     * @return whether the expired lease was removed by this instance
+     */
+    bool reclaim();
+
+    static QJsonObject read_json(const QString& filename);
+};
+
+/**
+ * @brief Sends the heartbeats of the leases of an instance from a thread of its own
+ *
+ * The render thread is blocked during synchronous steps such as writing the
+ * atompack of a large structure or stitching bands, which may take longer
+ * than the lease timeout. Were the heartbeats sent from its event loop, other
+ * instances could reclaim a lease that is still in use.
+ */
+class LeaseKeeper : public QThread {
+    Q_OBJECT
+
+private:
+    QHash<int, std::shared_ptr<JobLease>> leases;   // claims of this instance per job id
+    QMutex mutex;
+    QWaitCondition condition;
+    int interval;           // time between heartbeats in milliseconds
+    bool stopping = false;
+
+public:
+    /**
+     * @brief Constructs a new instance; call start() to send heartbeats
+     * @param _interval time between heartbeats in milliseconds
+     */
+    LeaseKeeper(int _interval);
+
+    ~LeaseKeeper();
+
+    /**
+     * @brief Send heartbeats for a lease held by this instance
+     */
+    void insert(int jobid, const std::shared_ptr<JobLease>& lease);
+
+    /**
+     * @brief Stop sending heartbeats for a lease
+     * @return the lease, null when no lease is kept for the job
+     */
+    std::shared_ptr<JobLease> take(int jobid);
+
+    /**
+     * @brief Stop the thread, keeping the leases
+     */
+    void stop();
+
+protected:
+    void run() override;
+
+signals:
+    /**
+     * @brief A lease has been taken over by another instance; its heartbeats have stopped
+     */
+    void signal_lease_lost(int jobid);
+};
+
+#endif // JOBLEASE_H
@@ -29,6 +29,15 @@ JobInfoWidget::JobInfoWidget(QWidget *parent) : QTabWidget(parent) {
     this->label_image->setAlignment (Qt::AlignCenter);
     layout->addWidget(this->label_image);
 
+    // previews are decoded in the background, such that browsing the jobs does not stall
+    this->preview_cache = new PreviewCache(256, this);
+    connect(this->preview_cache, SIGNAL(signal_preview_ready(QString)), this, SLOT(slot_preview_ready(QString)));
+    connect(this->preview_cache, SIGNAL(signal_preview_failed(QString,QString)), this, SLOT(slot_preview_failed(QString,QString)));
+
+    this->label_timings = new QLabel();
+    this->label_timings->setWordWrap(true);
+    layout->addWidget(this->label_timings);
+
     layout->addWidget(new QLabel("Rendering log"));
     this->text_job_info = new QPlainTextEdit();
     this->text_job_info->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
@@ -72,9 +81,11 @@ JobInfoWidget::JobInfoWidget(QWidget *parent) : QTabWidget(parent) {
 
 /**
  * @brief Rebuild structures based on AtomSettings data
+ * @param custom_json   custom JSON snippet holding the atom_colors and atom_radii directives
  */
-void JobInfoWidget::rebuild_structures() {
+void JobInfoWidget::rebuild_structures(const QString& custom_json) {
     qDebug() << "Rebuilding structures based on new JSON data";
+    this->anaglyph_widget->set_atom_style(AtomStyle(custom_json));
     this->anaglyph_widget->get_structure()->update();
     this->anaglyph_widget->update();
 }
@@ -84,15 +95,17 @@ void JobInfoWidget::slot_update_job_info(int job_id) {
     if(this->process_job_queue != nullptr) {
         this->text_job_info->clear();
         this->text_job_info->appendPlainText(this->process_job_queue->get_output(job_id).join('\n'));
+        this->label_timings->setText(this->build_timings_text(job_id));
         QString contcarpath = this->process_job_queue->get_file(job_id);
         this->label_job_path->setText(contcarpath);
         this->button_open_path->setEnabled(true);
 
-        QString imagepath = QFileInfo(contcarpath).absoluteDir().path() + "/image.png";
-        QFile imagefile(imagepath);
-        if(imagefile.exists()) {
-            QPixmap pixmap(imagepath);
-            this->label_image->setPixmap(pixmap.scaled(this->label_image->width(),this->label_image->height(),Qt::KeepAspectRatio));
+        this->imagepath = this->get_preview_path(job_id);
+        this->previewpath = this->get_preview_source(this->imagepath);
+        if(QFile::exists(this->imagepath)) {
+            if(!this->show_preview()) {
+                this->label_image->setText("Loading image...");
+            }
             this->label_image->setStyleSheet("border: 1px solid black;");
             this->button_save_image->setEnabled(true);
         } else {
@@ -100,11 +113,102 @@ void JobInfoWidget::slot_update_job_info(int job_id) {
             this->label_image->setStyleSheet("");
             this->button_save_image->setEnabled(false);
         }
+
+        // the neighbouring jobs are likely shown next
+        for(int offset : {1, -1, 2, -2}) {
+            int neighbour = job_id + offset;
+            if(neighbour >= 0 && neighbour < this->process_job_queue->get_nr_jobs()) {
+                this->preview_cache->prefetch(this->get_preview_source(this->get_preview_path(neighbour)),
+                                              this->label_image->size());
+            }
+        }
     } else {
         this->button_open_path->setEnabled(false);
     }
 }
 
+/**
+ * @brief Show a preview once it has been decoded, if it still belongs to the current job
+ */
+void JobInfoWidget::slot_preview_ready(const QString& path) {
+    if(path == this->previewpath) {
+        this->show_preview();
+    }
+}
+
+/**
+ * @brief Report an image of the current job that could not be decoded
+ */
+void JobInfoWidget::slot_preview_failed(const QString& path, const QString& error) {
+    if(path == this->previewpath) {
+        this->label_image->setText(tr("Could not load image: %1").arg(error));
+    }
+}
+
+/**
+ * @brief Summary of the time spent per phase of a job
+ */
+QString JobInfoWidget::build_timings_text(int job_id) const {
+    const QMap<QString, double>& timings = this->process_job_queue->get_timings(job_id);
+    if(timings.isEmpty()) {
+        return QString();
+    }
+
+    QStringList fields;
+    for(const QString& phase : ThreadRenderImage::get_timing_phases()) {
+        if(timings.contains(phase)) {
+            fields << tr("%1 %2 s").arg(QString(phase).replace('_', ' ')).arg(timings[phase], 0, 'f', 2);
+        }
+    }
+
+    return tr("Timings: ") + fields.join(" | ");
+}
+
+/**
+ * @brief Image shown for a job: its first view, or the draft until the final image is available
+ */
+QString JobInfoWidget::get_preview_path(int job_id) const {
+    QString path = this->process_job_queue->get_image_paths(job_id).front();
+    if(!QFile::exists(path)) {
+        path = this->process_job_queue->get_image_paths(job_id, true).front();
+    }
+
+    return path;
+}
+
+/**
+ * @brief File to decode the preview of an image from: its thumbnail when that fills the pane
+ */
+QString JobInfoWidget::get_preview_source(const QString& image) const {
+    QFileInfo thumbnail(OutputStage::get_thumbnail_path(image));
+    if(!thumbnail.exists() || thumbnail.lastModified() < QFileInfo(image).lastModified()) {
+        return image;
+    }
+
+    // a thumbnail smaller than the pane would show the image shrunken
+    QSize size = QImageReader(thumbnail.filePath()).size();
+    QSize bounds = this->label_image->size();
+    if(!size.isValid() || (size.width() < bounds.width() && size.height() < bounds.height())) {
+        return image;
+    }
+
+    return thumbnail.filePath();
+}
+
+/**
+ * @brief Show the preview of the current image
+ * @return whether the preview was available
+ */
+bool JobInfoWidget::show_preview() {
+    QImage preview;
+    if(!this->preview_cache->get(this->previewpath, this->label_image->size(), preview)) {
+        return false;
+    }
+
+    this->label_image->setPixmap(QPixmap::fromImage(preview));
+    return true;
+}
+
 void JobInfoWidget::slot_update_atom_label(int atom_id) {
     const Atom& atom = this->anaglyph_widget->get_structure()->get_atom(atom_id);
     this->label_selected_atom->setText(tr("Selected atom: %1 (#%2)").arg(AtomSettings::get().get_name_from_elnr(atom.atnr).c_str()).arg(atom_id+1));
@@ -129,8 +233,7 @@ void JobInfoWidget::slot_show_path_in_explorer_window() {
 }
 
 void JobInfoWidget::slot_save_image() {
-    QString imagepath = QFileInfo(this->label_job_path->text()).absoluteDir().path() + "/image.png";
-    QFile imagefile(imagepath);
+    QFile imagefile(this->imagepath);
     if(imagefile.exists()) {
         QString filename = QFileDialog::getSaveFileName(this, tr("Save File"),
                                                         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
@@ -12,6 +12,7 @@
 #include <QFileDialog>
 
 #include "threadrenderimage.h"
+#include "preview_cache.h"
 #include "visualization/anaglyph_widget.h"
 
 class JobInfoWidget : public QTabWidget
@@ -25,12 +26,18 @@ private:
 
     QPlainTextEdit* text_job_info;
     QLabel* label_image;
+    QLabel* label_timings;
     QLabel* label_selected_atom;
     QLabel* label_camera_euler;
     QLabel* label_zoom_level;
     QPushButton* button_insert_angle_json;
     QPushButton* button_insert_zoom_level;
 
+    QString imagepath;      // image shown for the current job
+    QString previewpath;    // file the preview of the current image is decoded from
+
+    PreviewCache* preview_cache;
+
     ThreadRenderImage* process_job_queue = nullptr;
     AnaglyphWidget* anaglyph_widget = nullptr;
 
@@ -55,8 +62,9 @@ public:
 
     /**
      * @brief Rebuild structures based on AtomSettings data
+     * @param custom_json   custom JSON snippet holding the atom_colors and atom_radii directives
      */
-    void rebuild_structures();
+    void rebuild_structures(const QString& custom_json);
 
 signals:
 
@@ -73,6 +81,38 @@ private slots:
     void slot_show_path_in_explorer_window();
 
     void slot_save_image();
+
+    /**
+     * @brief Show a preview once it has been decoded, if it still belongs to the current job
+     */
+    void slot_preview_ready(const QString& path);
+
+    /**
+     * @brief Report an image of the current job that could not be decoded
+     */
+    void slot_preview_failed(const QString& path, const QString& error);
+
+private:
+    /**
+     * @brief Summary of the time spent per phase of a job
+     */
+    QString build_timings_text(int job_id) const;
+
+    /**
+     * @brief Image shown for a job: its first view, or the draft until the final image is available
+     */
+    QString get_preview_path(int job_id) const;
+
+    /**
+     * @brief File to decode the preview of an image from: its thumbnail when that fills the pane
+     */
+    QString get_preview_source(const QString& image) const;
+
+    /**
+     * @brief Show the preview of the current image
+     * @return whether the preview was available
+     */
+    bool show_preview();
 };
 
 #endif // JOBINFOWIDGET_H
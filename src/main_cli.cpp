@@ -0,0 +1,334 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+/*
+ * Headless batch renderer
+ *
+ * Renders a folder or a list of structure files using the same job queue as the
+ * graphical interface. Progress is written to stdout as one JSON object per line,
+ * log messages are written to stderr.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDirIterator>
+#include <QTimer>
+#include <QSet>
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+
+#include "config.h"
+#include "atom_settings.h"
+#include "threadrenderimage.h"
+
+namespace {
+
+enum {
+    EXIT_OK = 0,
+    EXIT_JOBS_FAILED = 1,
+    EXIT_USAGE = 2
+};
+
+std::atomic<bool> interrupt_received(false);
+bool quiet = false;
+
+void handle_signal(int) {
+    interrupt_received = true;
+}
+
+/**
+ * @brief Send all log messages to stderr such that stdout only holds progress events
+ */
+void cli_message_output(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    UNUSED(context);
+
+    switch (type) {
+    case QtDebugMsg:
+        if(!quiet) {
+            std::cerr << "[D] " << msg.toStdString() << std::endl;
+        }
+        break;
+    case QtInfoMsg:
+        if(!quiet) {
+            std::cerr << "[I] " << msg.toStdString() << std::endl;
+        }
+        break;
+    case QtWarningMsg:
+        std::cerr << "[W] " << msg.toStdString() << std::endl;
+        break;
+    case QtCriticalMsg:
+        std::cerr << "[C] " << msg.toStdString() << std::endl;
+        break;
+    case QtFatalMsg:
+        std::cerr << "[F] " << msg.toStdString() << std::endl;
+        break;
+    }
+}
+
+/**
+ * @brief Write a single progress event as a line of JSON to stdout
+ */
+void print_event(const QString& event, QJsonObject data = QJsonObject()) {
+    data.insert("event", event);
+    std::fputs(QJsonDocument(data).toJson(QJsonDocument::Compact).constData(), stdout);
+    std::fputs("\n", stdout);
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Find structure files of a given type below a folder
+ */
+QStringList find_files(const QString& path, const QString& filetype) {
+    QStringList patterns;
+    if(filetype == "vasp") {
+        patterns = {"POSCAR*","CONTCAR*"};
+    } else if(filetype == "adf") {
+        patterns = {"logfile"};
+    } else if(filetype == "gaussian") {
+        patterns = {"*.LOG","*.log"};
+    } else if(filetype == "outcar") {
+        patterns = {"OUTCAR*"};
+    } else {
+        throw std::runtime_error("Unknown file type: " + filetype.toStdString());
+    }
+
+    QDirIterator it(QDir::cleanPath(path), patterns, QDir::Files, QDirIterator::Subdirectories);
+    QStringList files;
+    while(it.hasNext()) {
+        files << it.next();
+    }
+    files.sort();
+
+    return files;
+}
+
+/**
+ * @brief Read render parameters from a JSON file on top of the defaults
+ *
+ * The keys are identical to those collected from the settings panel. The
+ * custom_json entry can either be given as the raw snippet used by the
+ * settings panel or as a JSON object.
+ */
+QMap<QString, QVariant> load_parameters(const QString& filename) {
+    QMap<QString, QVariant> parameters = ThreadRenderImage::default_parameters();
+    if(filename.isEmpty()) {
+        return parameters;
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open parameter file: " + filename.toStdString());
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if(error.error != QJsonParseError::NoError || !doc.isObject()) {
+        throw std::runtime_error("Invalid parameter file " + filename.toStdString() + ": " + error.errorString().toStdString());
+    }
+
+    QJsonObject obj = doc.object();
+    for(auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        if(it.key() == "custom_json" && it.value().isObject()) {
+            // the manifest expects the bare key-value pairs including a trailing comma
+            QByteArray snippet = QJsonDocument(it.value().toObject()).toJson(QJsonDocument::Compact);
+            snippet = snippet.mid(1, snippet.size() - 2);
+            parameters.insert(it.key(), snippet.isEmpty() ? QString() : QString(snippet) + ",");
+        } else {
+            parameters.insert(it.key(), it.value().toVariant());
+        }
+    }
+
+    return parameters;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(PROGRAM_NAME_LC);
+    QCoreApplication::setApplicationVersion(PROGRAM_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString(PROGRAM_NAME) + " headless batch renderer");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("inputs", "Folder to search for structures or a list of structure files.", "<folder|files...>");
+    QCommandLineOption option_parameters({"p", "parameters"}, "JSON file with render parameters.", "file");
+    QCommandLineOption option_blender({"b", "blender"}, "Blender executable (default: blender on the PATH).", "executable");
+    QCommandLineOption option_output({"o", "output"}, "Folder to store the images in (default: next to the structure files).", "folder");
+    QCommandLineOption option_type({"t", "type"}, "Structure file type when searching a folder: vasp, adf, gaussian or outcar (default: vasp).", "type", "vasp");
+    QCommandLineOption option_reject({"r", "reject-file"}, "With a draft pass: file listing structures (or their folders) to skip in the final pass; re-read while the queue runs.", "file");
+    QCommandLineOption option_timings("timings", "Write the time spent per phase of every job to a CSV or JSON file once the queue is done.", "file");
+    QCommandLineOption option_quiet({"q", "quiet"}, "Only log warnings and errors.");
+    parser.addOptions({option_parameters, option_blender, option_output, option_type, option_reject, option_timings, option_quiet});
+    parser.process(app);
+
+    quiet = parser.isSet(option_quiet);
+    qInstallMessageHandler(cli_message_output);
+
+    QStringList inputs = parser.positionalArguments();
+    if(inputs.isEmpty()) {
+        std::cerr << "No input folder or files specified." << std::endl;
+        parser.showHelp(EXIT_USAGE);
+    }
+
+    QStringList files;
+    QString base_folder;
+    QMap<QString, QVariant> parameters;
+    QString blender;
+    try {
+        if(inputs.size() == 1 && QFileInfo(inputs.front()).isDir()) {
+            base_folder = QFileInfo(inputs.front()).absoluteFilePath();
+            files = find_files(base_folder, parser.value(option_type));
+        } else {
+            base_folder = QDir::currentPath();
+            for(const QString& input : inputs) {
+                if(!QFileInfo(input).isFile()) {
+                    throw std::runtime_error("Input file does not exist: " + input.toStdString());
+                }
+                files << QFileInfo(input).absoluteFilePath();
+            }
+        }
+
+        parameters = load_parameters(parser.value(option_parameters));
+        if(parser.isSet(option_reject)) {
+            parameters["reject_file"] = QFileInfo(parser.value(option_reject)).absoluteFilePath();
+        }
+
+        blender = parser.isSet(option_blender) ? parser.value(option_blender) : QStandardPaths::findExecutable("blender");
+        if(blender.isEmpty() || !QFileInfo(blender).isExecutable()) {
+            throw std::runtime_error("No Blender executable found, specify one using --blender.");
+        }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_USAGE;
+    }
+
+    if(files.isEmpty()) {
+        print_event("queue_done", {{"total", 0}, {"done", 0}, {"failed", 0}, {"cancelled", false}});
+        return EXIT_OK;
+    }
+
+    // bonds are detected with the custom bond distances, as in the settings panel
+    QString custom_json = parameters.value("custom_json").toString();
+    if(!custom_json.isEmpty()) {
+        AtomSettings::get().overwrite(custom_json.toStdString());
+    }
+
+    ThreadRenderImage queue;
+    queue.set_files(files);
+    queue.set_executable(blender);
+    queue.set_parameters(parameters);
+    if(parser.isSet(option_output)) {
+        QString output_folder = QFileInfo(parser.value(option_output)).absoluteFilePath();
+        QDir().mkpath(output_folder);
+        queue.set_output_folder(output_folder, base_folder);
+        queue.set_data_folder(output_folder);
+    } else {
+        queue.set_data_folder(base_folder);
+    }
+
+    int nr_done = 0;
+    int nr_rejected = 0;
+    QSet<int> failed;               // with a draft pass, a failed draft is followed by its final render
+    bool cancelled = false;
+
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_start, &app, [&](int jobid) {
+        print_event("job_start", {{"job", jobid}, {"file", queue.get_file(jobid)}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_progress, &app, [&](int jobid, double fraction, double eta) {
+        print_event("job_progress", {{"job", jobid}, {"fraction", fraction}, {"eta", eta}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_done, &app, [&](int jobid, int samples, int frames) {
+        nr_done++;
+        failed.remove(jobid);
+        print_event("job_done", {{"job", jobid}, {"file", queue.get_file(jobid)},
+                                 {"image", queue.get_image_paths(jobid).front()},
+                                 {"images", QJsonArray::fromStringList(queue.get_image_paths(jobid))},
+                                 {"process_time", queue.get_process_time(jobid)},
+                                 {"samples", samples},
+                                 {"frames", frames},
+                                 {"timings", queue.get_timings_json(jobid)},
+                                 {"progress", QString("%1/%2").arg(nr_done + failed.size()).arg(files.size())}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_failed, &app, [&](int jobid) {
+        failed.insert(jobid);
+        print_event("job_failed", {{"job", jobid}, {"file", queue.get_file(jobid)},
+                                   {"output", QJsonArray::fromStringList(queue.get_output(jobid))},
+                                   {"progress", QString("%1/%2").arg(nr_done + failed.size()).arg(files.size())}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_draft_done, &app, [&](int jobid) {
+        print_event("draft_done", {{"job", jobid}, {"file", queue.get_file(jobid)},
+                                   {"images", QJsonArray::fromStringList(queue.get_image_paths(jobid, true))},
+                                   {"process_time", queue.get_process_time(jobid)}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_job_rejected, &app, [&](int jobid) {
+        nr_rejected++;
+        failed.remove(jobid);
+        print_event("job_rejected", {{"job", jobid}, {"file", queue.get_file(jobid)},
+                                     {"progress", QString("%1/%2").arg(nr_done + failed.size() + nr_rejected).arg(files.size())}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_queue_eta, &app, [&](double seconds) {
+        print_event("queue_eta", {{"eta", seconds}});
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_queue_cancelled, &app, [&]() {
+        cancelled = true;
+    });
+    QObject::connect(&queue, &ThreadRenderImage::signal_queue_done, &app, [&]() {
+        print_event("queue_done", {{"total", files.size()}, {"done", nr_done}, {"failed", failed.size()},
+                                   {"rejected", nr_rejected}, {"cancelled", cancelled}});
+        app.exit((!failed.isEmpty() || cancelled || nr_done + nr_rejected != files.size()) ? EXIT_JOBS_FAILED : EXIT_OK);
+    });
+
+    // batch schedulers terminate jobs using SIGTERM, forward it to the queue
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    QTimer timer_interrupt;
+    QObject::connect(&timer_interrupt, &QTimer::timeout, &app, [&]() {
+        if(interrupt_received && !queue.isInterruptionRequested()) {
+            qWarning() << "Interrupt received: cancelling queue.";
+            queue.requestInterruption();
+        }
+    });
+    timer_interrupt.start(100);
+
+    print_event("queue_start", {{"total", files.size()}, {"blender", blender}});
+    queue.start();
+    int exitcode = app.exec();
+    queue.wait();
+
+    if(parser.isSet(option_timings)) {
+        try {
+            queue.export_timings(parser.value(option_timings));
+        } catch (const std::exception& e) {
+            qCritical() << e.what();
+        }
+    }
+
+    return exitcode;
+}
@@ -80,6 +80,10 @@ MainWindow::MainWindow(const std::shared_ptr<QStringList> _log_messages, QWidget
     this->button_cancel = new QPushButton("Cancel");
     layout_buttons->addWidget(this->button_cancel);
     this->button_cancel->setVisible(false);
+    this->button_reject = new QPushButton("Reject");
+    this->button_reject->setToolTip("Skip the final render of the selected job");
+    layout_buttons->addWidget(this->button_reject);
+    this->button_reject->setVisible(false);
 
     this->progress_bar = new QProgressBar();
     layout_left->addWidget(this->progress_bar);
@@ -87,6 +91,7 @@ MainWindow::MainWindow(const std::shared_ptr<QStringList> _log_messages, QWidget
 
     connect(this->button_select_folder, SIGNAL(released()), this, SLOT(slot_select_folder()));
     connect(this->button_cancel, SIGNAL(released()), this, SLOT(slot_cancel_queue()));
+    connect(this->button_reject, SIGNAL(released()), this, SLOT(slot_reject_job()));
     connect(this->button_parse_files, SIGNAL(released()), this, SLOT(slot_parse_files()));
     connect(this->button_run_single_job, SIGNAL(released()), this, SLOT(slot_parse_single_job()));
     connect(this->listview_items, SIGNAL(currentRowChanged(int)), this->widget_job_info, SLOT(slot_update_job_info(int)));
@@ -126,6 +131,12 @@ void MainWindow::build_dropdown_menu() {
     menuFile->addAction(action_open);
     connect(action_open, &QAction::triggered, this, &MainWindow::slot_select_folder);
 
+    // export the timings of the jobs
+    QAction *action_export_timings = new QAction(menuFile);
+    action_export_timings->setText(tr("Export timings"));
+    menuFile->addAction(action_export_timings);
+    connect(action_export_timings, &QAction::triggered, this, &MainWindow::slot_export_timings);
+
     // quit
     QAction *action_quit = new QAction(menuFile);
     action_quit->setText(tr("Quit"));
@@ -207,6 +218,16 @@ void MainWindow::build_blender_settings_panel(QVBoxLayout* layout) {
     this->combobox_camera_direction->addItem("X+");
     this->combobox_camera_direction->addItem("X-");
 
+    // render additional views of the same scene, e.g. "Z+, X+:0/90/0"
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Views"), rownr, 0);
+    this->lineedit_views = new QLineEdit();
+    layout_blender_settings->addWidget(this->lineedit_views, rownr, 1);
+    this->lineedit_views->setPlaceholderText("single view");
+    this->lineedit_views->setToolTip("Comma separated list of views rendered in a single Blender session.\n"
+                                     "Each view is a camera direction (Z+), object Euler angles (30/0/90)\n"
+                                     "or both (X+:30/0/90) and is stored as image_<view>.png.");
+
     // whether to hide the axes
     rownr++;
     layout_blender_settings->addWidget(new QLabel("Hide axes"), rownr, 0);
@@ -244,6 +265,17 @@ void MainWindow::build_blender_settings_panel(QVBoxLayout* layout) {
     this->spinbox_resolution_y->setMaximum(2048);
     this->spinbox_resolution_y->setValue(512);
 
+    // file format of the published images, the formats depend on the Qt image plugins
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Image format"), rownr, 0);
+    this->combobox_output_format = new QComboBox();
+    layout_blender_settings->addWidget(this->combobox_output_format, rownr, 1);
+    for(const auto& format : {std::make_pair("PNG", "png"), std::make_pair("JPEG", "jpg"), std::make_pair("WebP", "webp")}) {
+        if(OutputStage::get_extension(format.second) == format.second) {
+            this->combobox_output_format->addItem(format.first, QVariant(format.second));
+        }
+    }
+
     // tile size in x direction
     rownr++;
     layout_blender_settings->addWidget(new QLabel("Tile x"), rownr, 0);
@@ -267,10 +299,55 @@ void MainWindow::build_blender_settings_panel(QVBoxLayout* layout) {
     layout_blender_settings->addWidget(new QLabel("Samples"), rownr, 0);
     this->spinbox_samples = new QSpinBox();
     layout_blender_settings->addWidget(this->spinbox_samples, rownr, 1);
-    this->spinbox_samples->setMinimum(128);
+    this->spinbox_samples->setMinimum(1);
     this->spinbox_samples->setMaximum(2048);
     this->spinbox_samples->setValue(128);
 
+    // stop sampling a pixel once its noise is below the threshold
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Adaptive sampling"), rownr, 0);
+    this->checkbox_adaptive_sampling = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_adaptive_sampling, rownr, 1);
+
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Noise threshold"), rownr, 0);
+    this->spinbox_noise_threshold = new QDoubleSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_noise_threshold, rownr, 1);
+    this->spinbox_noise_threshold->setDecimals(3);
+    this->spinbox_noise_threshold->setMinimum(0.001);
+    this->spinbox_noise_threshold->setMaximum(1.0);
+    this->spinbox_noise_threshold->setSingleStep(0.005);
+    this->spinbox_noise_threshold->setValue(0.01);
+    this->spinbox_noise_threshold->setEnabled(false);
+    connect(this->checkbox_adaptive_sampling, &QCheckBox::toggled, this->spinbox_noise_threshold, &QWidget::setEnabled);
+
+    // denoising allows for far fewer samples
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Denoise (OpenImageDenoise)"), rownr, 0);
+    this->checkbox_denoise = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_denoise, rownr, 1);
+    this->checkbox_denoise->setToolTip("Denoise the images on the CPU; 32 samples with denoising\n"
+                                       "typically replace 512 samples without");
+
+    // reduce the samples of jobs that would not finish in time
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Time budget per job (s)"), rownr, 0);
+    this->spinbox_job_time_budget = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_job_time_budget, rownr, 1);
+    this->spinbox_job_time_budget->setMinimum(0);
+    this->spinbox_job_time_budget->setMaximum(24 * 60 * 60);
+    this->spinbox_job_time_budget->setSpecialValueText("unlimited");
+    this->spinbox_job_time_budget->setValue(0);
+
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Queue deadline (min)"), rownr, 0);
+    this->spinbox_queue_deadline = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_queue_deadline, rownr, 1);
+    this->spinbox_queue_deadline->setMinimum(0);
+    this->spinbox_queue_deadline->setMaximum(7 * 24 * 60);
+    this->spinbox_queue_deadline->setSpecialValueText("none");
+    this->spinbox_queue_deadline->setValue(0);
+
     // number of subdivions for the spheres
     rownr++;
     layout_blender_settings->addWidget(new QLabel("Number of subdivions"), rownr, 0);
@@ -280,6 +357,132 @@ void MainWindow::build_blender_settings_panel(QVBoxLayout* layout) {
     this->spinbox_nsubdiv->setMaximum(5);
     this->spinbox_nsubdiv->setValue(4);
 
+    // coarser meshes for atoms and bonds that are small in the image
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Mesh detail (px per segment)"), rownr, 0);
+    this->spinbox_lod_segment_pixels = new QDoubleSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_lod_segment_pixels, rownr, 1);
+    this->spinbox_lod_segment_pixels->setDecimals(1);
+    this->spinbox_lod_segment_pixels->setMinimum(0.0);
+    this->spinbox_lod_segment_pixels->setMaximum(16.0);
+    this->spinbox_lod_segment_pixels->setSingleStep(0.5);
+    this->spinbox_lod_segment_pixels->setSpecialValueText("full");
+    this->spinbox_lod_segment_pixels->setValue(2.0);
+    this->spinbox_lod_segment_pixels->setToolTip("Largest length in pixels of the segments along the outline of an\n"
+                                                 "atom or bond; the number of subdivisions is the upper bound");
+
+    // a single sphere and cylinder for all atoms and bonds
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Instance atoms and bonds"), rownr, 0);
+    this->checkbox_instancing = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_instancing, rownr, 1);
+    this->checkbox_instancing->setToolTip("Build the scene from instances of a single sphere and cylinder,\n"
+                                          "which is much faster for large structures (not for animations)");
+
+    // render the structures of a trajectory as frames rather than only the final one
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Render trajectories as animation"), rownr, 0);
+    this->checkbox_animation = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_animation, rownr, 1);
+    this->checkbox_animation->setToolTip("Render every ionic step of an OUTCAR as a frame; otherwise only\n"
+                                         "the final structure is rendered");
+
+    // only render every n-th ionic step of a trajectory
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Animation frame step"), rownr, 0);
+    this->spinbox_frame_step = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_frame_step, rownr, 1);
+    this->spinbox_frame_step->setMinimum(1);
+    this->spinbox_frame_step->setMaximum(1000);
+    this->spinbox_frame_step->setValue(1);
+
+    // number of Blender processes running concurrently
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Concurrent jobs"), rownr, 0);
+    this->spinbox_nr_workers = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_nr_workers, rownr, 1);
+    this->spinbox_nr_workers->setMinimum(1);
+    this->spinbox_nr_workers->setMaximum(std::max(1, QThread::idealThreadCount()));
+    this->spinbox_nr_workers->setValue(1);
+
+    // device Cycles renders on; without a GPU the CPU is used in any case
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Render device"), rownr, 0);
+    this->combobox_render_device = new QComboBox();
+    layout_blender_settings->addWidget(this->combobox_render_device, rownr, 1);
+    this->combobox_render_device->addItem("GPU if available", QVariant("auto"));
+    this->combobox_render_device->addItem("CPU", QVariant("cpu"));
+
+    // CPU threads of every Blender process, each process is pinned to its own cores
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Threads per job"), rownr, 0);
+    this->spinbox_threads_per_worker = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_threads_per_worker, rownr, 1);
+    this->spinbox_threads_per_worker->setMinimum(0);
+    this->spinbox_threads_per_worker->setMaximum(std::max(1, QThread::idealThreadCount()));
+    this->spinbox_threads_per_worker->setSpecialValueText("auto");
+    this->spinbox_threads_per_worker->setValue(0);
+
+    // split the last images of the queue into bands for the idle workers
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Split image into bands"), rownr, 0);
+    this->spinbox_split_tiles = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_split_tiles, rownr, 1);
+    this->spinbox_split_tiles->setMinimum(1);
+    this->spinbox_split_tiles->setMaximum(64);
+    this->spinbox_split_tiles->setSpecialValueText("off");
+    this->spinbox_split_tiles->setValue(1);
+
+    // order in which the jobs are rendered, based on their predicted render time
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Queue order"), rownr, 0);
+    this->combobox_queue_order = new QComboBox();
+    layout_blender_settings->addWidget(this->combobox_queue_order, rownr, 1);
+    this->combobox_queue_order->addItem("File order", QVariant("file"));
+    this->combobox_queue_order->addItem("Longest first", QVariant("longest"));
+    this->combobox_queue_order->addItem("Shortest first", QVariant("shortest"));
+
+    // whether to keep Blender resident in between jobs
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Persistent Blender session"), rownr, 0);
+    this->checkbox_session_mode = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_session_mode, rownr, 1);
+
+    // whether to skip jobs that were rendered before with identical input
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Use render cache"), rownr, 0);
+    this->checkbox_use_cache = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_use_cache, rownr, 1);
+
+    // maximum size of the render cache
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Cache size (MB)"), rownr, 0);
+    this->spinbox_cache_size = new QSpinBox();
+    layout_blender_settings->addWidget(this->spinbox_cache_size, rownr, 1);
+    this->spinbox_cache_size->setMinimum(16);
+    this->spinbox_cache_size->setMaximum(65536);
+    this->spinbox_cache_size->setValue(1024);
+
+    // whether to skip jobs that the journal marks as completed
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Resume previous queue"), rownr, 0);
+    this->checkbox_resume = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_resume, rownr, 1);
+
+    // whether to render quick drafts of all jobs before the final images
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Draft pass first"), rownr, 0);
+    this->checkbox_draft_pass = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_draft_pass, rownr, 1);
+    this->checkbox_draft_pass->setToolTip("Render all jobs at a quarter of the resolution with 16 samples first;\n"
+                                          "jobs can be rejected before their final render starts.");
+
+    // whether to share the jobs with other instances working on the same folder
+    rownr++;
+    layout_blender_settings->addWidget(new QLabel("Share queue with other hosts"), rownr, 0);
+    this->checkbox_distributed = new QCheckBox();
+    layout_blender_settings->addWidget(this->checkbox_distributed, rownr, 1);
+
     rownr++;
     layout_blender_settings->addWidget(new QLabel("Material for atoms"), rownr, 0);
     this->combobox_atom_material = new QComboBox();
@@ -360,6 +563,69 @@ QString MainWindow::fetch_tooltip_text(const QString& filename) {
     return {};
 }
 
+/**
+ * @brief Collect Blender settings from the settings panel
+ */
+QMap<QString, QVariant> MainWindow::collect_parameters() const {
+    QMap<QString, QVariant> parameters;
+    parameters.insert("ortho_scale", QVariant(this->combobox_ortho_scale->currentText()));
+    parameters.insert("ortho_custom_scale", QVariant(this->spinbox_custom_ortho_scale->value()));
+    parameters.insert("camera_direction", QVariant(this->combobox_camera_direction->currentText()));
+    parameters.insert("views", QVariant(this->lineedit_views->text()));
+    parameters.insert("show_unitcell", QVariant(this->checkbox_unitcell->isChecked()));
+    parameters.insert("expansion", QVariant(this->checkbox_expansion->isChecked()));
+    parameters.insert("hide_axes", QVariant(this->checkbox_axes->isChecked()));
+    parameters.insert("resolution_x", QVariant(this->spinbox_resolution_x->value()));
+    parameters.insert("resolution_y", QVariant(this->spinbox_resolution_y->value()));
+    parameters.insert("tile_x", QVariant(this->spinbox_tile_x->value()));
+    parameters.insert("tile_y", QVariant(this->spinbox_tile_y->value()));
+    parameters.insert("samples", QVariant(this->spinbox_samples->value()));
+    parameters.insert("output_format", this->combobox_output_format->currentData());
+    parameters.insert("adaptive_sampling", QVariant(this->checkbox_adaptive_sampling->isChecked()));
+    parameters.insert("noise_threshold", QVariant(this->spinbox_noise_threshold->value()));
+    parameters.insert("denoise", QVariant(this->checkbox_denoise->isChecked()));
+    parameters.insert("nsubdiv", QVariant(this->spinbox_nsubdiv->value()));
+    parameters.insert("lod_segment_pixels", QVariant(this->spinbox_lod_segment_pixels->value()));
+    parameters.insert("instancing", QVariant(this->checkbox_instancing->isChecked()));
+    parameters.insert("animation", QVariant(this->checkbox_animation->isChecked()));
+    parameters.insert("frame_step", QVariant(this->spinbox_frame_step->value()));
+    parameters.insert("job_time_budget", QVariant(this->spinbox_job_time_budget->value()));
+    parameters.insert("queue_deadline", QVariant(this->spinbox_queue_deadline->value() * 60));
+    parameters.insert("atmat", QVariant(this->combobox_atom_material->currentText()));
+    parameters.insert("bondmat", QVariant(this->combobox_bond_material->currentText()));
+    parameters.insert("custom_json", QVariant(this->plaintext_modding->toPlainText()));
+    parameters.insert("nr_workers", QVariant(this->spinbox_nr_workers->value()));
+    parameters.insert("render_device", this->combobox_render_device->currentData());
+    parameters.insert("threads_per_worker", QVariant(this->spinbox_threads_per_worker->value()));
+    parameters.insert("split_tiles", QVariant(this->spinbox_split_tiles->value()));
+    parameters.insert("queue_order", this->combobox_queue_order->currentData());
+    parameters.insert("session_mode", QVariant(this->checkbox_session_mode->isChecked()));
+    parameters.insert("use_cache", QVariant(this->checkbox_use_cache->isChecked()));
+    parameters.insert("cache_size_mb", QVariant(this->spinbox_cache_size->value()));
+    parameters.insert("resume", QVariant(this->checkbox_resume->isChecked()));
+    parameters.insert("draft_pass", QVariant(this->checkbox_draft_pass->isChecked()));
+    parameters.insert("distributed", QVariant(this->checkbox_distributed->isChecked()));
+    parameters.insert("lease_timeout", QVariant(300));
+
+    return parameters;
+}
+
+/**
+ * @brief Connect the signals of the job queue to this window
+ */
+void MainWindow::connect_job_queue() {
+    // the queue object is re-used for every launch, avoid duplicate connections
+    connect(process_job_queue.get(), SIGNAL(signal_job_done(int,int,int)), this, SLOT(slot_job_done(int,int,int)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_job_start(int)), this, SLOT(slot_job_start(int)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_job_failed(int)), this, SLOT(slot_job_failed(int)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_draft_done(int)), this, SLOT(slot_draft_done(int)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_job_rejected(int)), this, SLOT(slot_job_rejected(int)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_job_progress(int,double,double)), this, SLOT(slot_job_progress(int,double,double)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_queue_done()), this, SLOT(slot_queue_done()), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_queue_eta(double)), this, SLOT(slot_queue_eta(double)), Qt::UniqueConnection);
+    connect(process_job_queue.get(), SIGNAL(signal_queue_cancelled()), this, SLOT(slot_queue_cancelled()), Qt::UniqueConnection);
+}
+
 void MainWindow::slot_parse_files() {
     // disable all buttons
     this->button_parse_files->setEnabled(false);
@@ -372,35 +638,27 @@ void MainWindow::slot_parse_files() {
     // disable run single job button
     this->button_run_single_job->setEnabled(false);
 
-    // set progress bar
-    this->progress_bar->setMaximum(this->listview_items->count());
+    // enable rejection of jobs after their draft
+    this->button_reject->setVisible(this->checkbox_draft_pass->isChecked());
+
+    // set progress bar; with a draft pass every job is rendered twice
+    int nr_passes = this->checkbox_draft_pass->isChecked() ? 2 : 1;
+    this->progress_bar->setMaximum(this->listview_items->count() * nr_passes * PROGRESS_RESOLUTION);
+    this->progress_bar->setValue(0);
+    this->nr_jobs_finished = 0;
+    this->job_progress.clear();
+    for(unsigned int& status : this->job_status) {
+        status = JOB_QUEUED;
+    }
 
     // set queue job
     this->process_job_queue->set_single_job_id(-1);
 
     // connect signals and slots
-    connect(process_job_queue.get(), SIGNAL(signal_job_done(int)), this, SLOT(slot_job_done(int)));
-    connect(process_job_queue.get(), SIGNAL(signal_job_start(int)), this, SLOT(slot_job_start(int)));
-    connect(process_job_queue.get(), SIGNAL(signal_queue_done()), this, SLOT(slot_queue_done()));
-    connect(process_job_queue.get(), SIGNAL(signal_queue_cancelled()), this, SLOT(slot_queue_cancelled()));
+    this->connect_job_queue();
 
     // collect blender settings
-    QMap<QString, QVariant> parameters;
-    parameters.insert("ortho_scale", QVariant(this->combobox_ortho_scale->currentText()));
-    parameters.insert("ortho_custom_scale", QVariant(this->spinbox_custom_ortho_scale->value()));
-    parameters.insert("camera_direction", QVariant(this->combobox_camera_direction->currentText()));
-    parameters.insert("show_unitcell", QVariant(this->checkbox_unitcell->isChecked()));
-    parameters.insert("expansion", QVariant(this->checkbox_expansion->isChecked()));
-    parameters.insert("hide_axes", QVariant(this->checkbox_axes->isChecked()));
-    parameters.insert("resolution_x", QVariant(this->spinbox_resolution_x->value()));
-    parameters.insert("resolution_y", QVariant(this->spinbox_resolution_y->value()));
-    parameters.insert("tile_x", QVariant(this->spinbox_tile_x->value()));
-    parameters.insert("tile_y", QVariant(this->spinbox_tile_y->value()));
-    parameters.insert("samples", QVariant(this->spinbox_samples->value()));
-    parameters.insert("nsubdiv", QVariant(this->spinbox_nsubdiv->value()));
-    parameters.insert("atmat", QVariant(this->combobox_atom_material->currentText()));
-    parameters.insert("bondmat", QVariant(this->combobox_bond_material->currentText()));
-    parameters.insert("custom_json", QVariant(this->plaintext_modding->toPlainText()));
+    QMap<QString, QVariant> parameters = this->collect_parameters();
 
     // set icon when jobs are in queue
     static const QIcon icon(":/assets/icons/queue.png");
@@ -425,35 +683,25 @@ void MainWindow::slot_parse_single_job() {
     // disable run single job button
     this->button_run_single_job->setEnabled(false);
 
-    // set progress bar
-    this->progress_bar->setMaximum(1);
+    // enable rejection of jobs after their draft
+    this->button_reject->setVisible(this->checkbox_draft_pass->isChecked());
+
+    // set progress bar; with a draft pass every job is rendered twice
+    int nr_passes = this->checkbox_draft_pass->isChecked() ? 2 : 1;
+    this->progress_bar->setMaximum(nr_passes * PROGRESS_RESOLUTION);
+    this->progress_bar->setValue(0);
+    this->nr_jobs_finished = 0;
+    this->job_progress.clear();
 
     int jobid = this->listview_items->currentRow();
+    this->job_status[jobid] = JOB_QUEUED;
     this->process_job_queue->set_single_job_id(jobid);
 
     // connect signals and slots
-    connect(process_job_queue.get(), SIGNAL(signal_job_done(int)), this, SLOT(slot_job_done(int)));
-    connect(process_job_queue.get(), SIGNAL(signal_job_start(int)), this, SLOT(slot_job_start(int)));
-    connect(process_job_queue.get(), SIGNAL(signal_queue_done()), this, SLOT(slot_queue_done()));
-    connect(process_job_queue.get(), SIGNAL(signal_queue_cancelled()), this, SLOT(slot_queue_cancelled()));
+    this->connect_job_queue();
 
     // collect blender settings
-    QMap<QString, QVariant> parameters;
-    parameters.insert("ortho_scale", QVariant(this->combobox_ortho_scale->currentText()));
-    parameters.insert("ortho_custom_scale", QVariant(this->spinbox_custom_ortho_scale->value()));
-    parameters.insert("camera_direction", QVariant(this->combobox_camera_direction->currentText()));
-    parameters.insert("show_unitcell", QVariant(this->checkbox_unitcell->isChecked()));
-    parameters.insert("expansion", QVariant(this->checkbox_expansion->isChecked()));
-    parameters.insert("hide_axes", QVariant(this->checkbox_axes->isChecked()));
-    parameters.insert("resolution_x", QVariant(this->spinbox_resolution_x->value()));
-    parameters.insert("resolution_y", QVariant(this->spinbox_resolution_y->value()));
-    parameters.insert("tile_x", QVariant(this->spinbox_tile_x->value()));
-    parameters.insert("tile_y", QVariant(this->spinbox_tile_y->value()));
-    parameters.insert("samples", QVariant(this->spinbox_samples->value()));
-    parameters.insert("nsubdiv", QVariant(this->spinbox_nsubdiv->value()));
-    parameters.insert("atmat", QVariant(this->combobox_atom_material->currentText()));
-    parameters.insert("bondmat", QVariant(this->combobox_bond_material->currentText()));
-    parameters.insert("custom_json", QVariant(this->plaintext_modding->toPlainText()));
+    QMap<QString, QVariant> parameters = this->collect_parameters();
 
     // set icon when jobs are in queue
     static const QIcon icon(":/assets/icons/queue.png");
@@ -498,6 +746,8 @@ void MainWindow::slot_select_folder() {
         files = this->find_files(path, {"logfile"});
     } else if(this->combobox_file_types->currentText() == this->GEOMETRY_FILETYPES[2]) { // Gaussian log files
         files = this->find_files(path, {"*.LOG","*.log"});
+    } else if(this->combobox_file_types->currentText() == this->GEOMETRY_FILETYPES[3]) { // VASP OUTCAR trajectories
+        files = this->find_files(path, {"OUTCAR*"});
     } else {
         throw std::runtime_error("Invalid selection. Terminating program.");
     }
@@ -523,37 +773,133 @@ void MainWindow::slot_select_folder() {
     this->process_job_queue = std::make_unique<ThreadRenderImage>();
     this->widget_job_info->set_process_job_queue_ptr(this->process_job_queue.get());
     process_job_queue->set_files(files);
+    process_job_queue->set_data_folder(path);
     process_job_queue->set_executable(this->combobox_blender_executable->currentText());
 }
 
 void MainWindow::slot_job_start(int jobid) {
-    this->progress_bar->setValue(jobid+1);
-
     static const QIcon icon(":/assets/icons/processor.png");
 
     this->listview_items->item(jobid)->setIcon(icon);
+    this->listview_items->item(jobid)->setText(this->process_job_queue->get_file(jobid));
     this->job_status[jobid] = JOB_RUNNING;
+    this->job_progress[jobid] = 0.0;
 }
 
-void MainWindow::slot_job_done(int jobid) {
-    this->progress_bar->setValue(jobid+1);
+void MainWindow::slot_job_progress(int jobid, double fraction, double eta) {
+    if(this->job_status[jobid] != JOB_RUNNING) {
+        return;
+    }
 
+    this->job_progress[jobid] = fraction;
+    int eta_seconds = std::max(0, (int)std::round(eta));
+    QString newtext = this->process_job_queue->get_file(jobid) +
+                      tr(" (%1%, %2:%3 remaining)").arg((int)(fraction * 100.0))
+                                                    .arg(eta_seconds / 60)
+                                                    .arg(eta_seconds % 60, 2, 10, QChar('0'));
+    this->listview_items->item(jobid)->setText(newtext);
+    this->update_progress_bar();
+}
+
+/**
+ * @brief Set the progress bar from the finished jobs and the progress of running jobs
+ */
+void MainWindow::update_progress_bar() {
+    double running = 0.0;
+    for(double fraction : this->job_progress) {
+        running += fraction;
+    }
+    this->progress_bar->setValue((int)((this->nr_jobs_finished + running) * PROGRESS_RESOLUTION));
+}
+
+void MainWindow::slot_job_done(int jobid, int samples, int frames) {
     static const QIcon icon(":/assets/icons/image.png");
 
     this->listview_items->item(jobid)->setIcon(icon);
     double ptime = this->process_job_queue->get_process_time(jobid);
-    QString newtext = this->listview_items->item(jobid)->text() + tr(" (%1 sec.)").arg(ptime);
+    QString newtext = this->process_job_queue->get_file(jobid) + tr(" (%1 sec., %2 samples)").arg(ptime).arg(samples);
+    if(frames > 0) {
+        newtext = this->process_job_queue->get_file(jobid) + tr(" (%1 sec., %2 samples, %3 frames)").arg(ptime)
+                  .arg(samples).arg(frames);
+    }
     this->listview_items->item(jobid)->setText(newtext);
     this->job_status[jobid] = JOB_COMPLETED;
+    this->job_progress.remove(jobid);
+    this->nr_jobs_finished++;
+    this->update_progress_bar();
     this->listview_items->setCurrentRow(jobid);
     this->widget_job_info->slot_update_job_info(jobid);
 }
 
+void MainWindow::slot_job_failed(int jobid) {
+    static const QIcon icon(":/assets/icons/cancelled.png");
+
+    this->listview_items->item(jobid)->setIcon(icon);
+    this->listview_items->item(jobid)->setText(this->process_job_queue->get_file(jobid));
+    this->job_status[jobid] = JOB_FAILED;
+    this->job_progress.remove(jobid);
+    this->nr_jobs_finished++;
+    this->update_progress_bar();
+}
+
+void MainWindow::slot_draft_done(int jobid) {
+    static const QIcon icon(":/assets/icons/queue.png");
+
+    this->listview_items->item(jobid)->setIcon(icon);
+    QString newtext = this->process_job_queue->get_file(jobid) + tr(" (draft, %1 sec.)").arg(this->process_job_queue->get_process_time(jobid));
+    this->listview_items->item(jobid)->setText(newtext);
+    this->job_status[jobid] = JOB_DRAFTED;
+    this->job_progress.remove(jobid);
+    this->nr_jobs_finished++;
+    this->update_progress_bar();
+
+    // show the draft unless another job is being inspected
+    if(this->listview_items->currentRow() == jobid) {
+        this->widget_job_info->slot_update_job_info(jobid);
+    }
+}
+
+void MainWindow::slot_job_rejected(int jobid) {
+    static const QIcon icon(":/assets/icons/cancelled.png");
+
+    this->listview_items->item(jobid)->setIcon(icon);
+    this->listview_items->item(jobid)->setText(this->process_job_queue->get_file(jobid) + tr(" (rejected)"));
+    this->job_status[jobid] = JOB_REJECTED;
+    this->job_progress.remove(jobid);
+    this->nr_jobs_finished++;
+    this->update_progress_bar();
+}
+
+/**
+ * @brief Exclude the selected job from the final pass
+ */
+void MainWindow::slot_reject_job() {
+    int jobid = this->listview_items->currentRow();
+    if(jobid < 0 || !this->process_job_queue || !this->process_job_queue->isRunning()) {
+        return;
+    }
+
+    // a final render that has already started is not interrupted
+    if(this->job_status[jobid] == JOB_QUEUED || this->job_status[jobid] == JOB_DRAFTED) {
+        this->process_job_queue->reject(jobid);
+        this->listview_items->item(jobid)->setText(this->process_job_queue->get_file(jobid) + tr(" (to be rejected)"));
+    }
+}
+
 void MainWindow::slot_queue_done() {
     this->button_parse_files->setEnabled(true);
     this->button_select_folder->setEnabled(true);
     this->button_cancel->setVisible(false);
+    this->button_reject->setVisible(false);
     this->button_run_single_job->setEnabled(true);
+    this->progress_bar->setFormat("%p%");
+}
+
+void MainWindow::slot_queue_eta(double seconds) {
+    int eta = std::max(0, (int)std::round(seconds));
+    this->progress_bar->setFormat(tr("%p% (%1:%2:%3 remaining)").arg(eta / 3600)
+                                                                .arg((eta / 60) % 60, 2, 10, QChar('0'))
+                                                                .arg(eta % 60, 2, 10, QChar('0')));
 }
 
 void MainWindow::slot_probe_gpu() {
@@ -627,7 +973,7 @@ void MainWindow::slot_set_zoom_level() {
 
 void MainWindow::slot_cancel_queue() {
     if(this->process_job_queue && this->process_job_queue.get()->isRunning()) {
-        qDebug() << "Requesting interruption of queue, wait until current job is finished...";
+        qDebug() << "Requesting interruption of queue, killing running jobs...";
         this->process_job_queue->requestInterruption();
         this->button_cancel->setEnabled(false);
     }
@@ -639,8 +985,11 @@ void MainWindow::slot_queue_cancelled() {
     this->button_select_folder->setEnabled(true);
     this->button_run_single_job->setEnabled(true);
     this->button_cancel->setVisible(false);
+    this->button_reject->setVisible(false);
     this->progress_bar->reset();
     this->progress_bar->setValue(0);
+    this->progress_bar->setFormat("%p%");
+    this->job_progress.clear();
 
     // set icon when jobs are in queue
     static const QIcon icon(":/assets/icons/cancelled.png");
@@ -648,6 +997,7 @@ void MainWindow::slot_queue_cancelled() {
         if(this->job_status[i] < JOB_COMPLETED) {
             this->job_status[i] = JOB_CANCELLED;
             this->listview_items->item(i)->setIcon(icon);
+            this->listview_items->item(i)->setText(this->process_job_queue->get_file(i));
         }
     }
 }
@@ -660,6 +1010,29 @@ void MainWindow::slot_debug_log() {
     this->log_window->show();
 }
 
+/**
+ * @brief Save the per-phase timings of all jobs as CSV or JSON
+ */
+void MainWindow::slot_export_timings() {
+    if(!this->process_job_queue || this->process_job_queue->isRunning()) {
+        QMessageBox::warning(this, tr("Export timings"), tr("Timings can be exported once the queue has finished."));
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export timings"),
+                                                    QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/timings.csv",
+                                                    tr("CSV (*.csv);;JSON (*.json)"));
+    if(filename.isEmpty()) {
+        return;
+    }
+
+    try {
+        this->process_job_queue->export_timings(filename);
+    } catch (const std::exception& e) {
+        QMessageBox::critical(this, tr("Export timings"), e.what());
+    }
+}
+
 void MainWindow::slot_about() {
     QMessageBox message_box;
         //message_box.setStyleSheet("QLabel{min-width: 250px; font-weight: normal;}");
@@ -680,5 +1053,5 @@ void MainWindow::slot_rebuild_structures() {
     AtomSettings::get().overwrite(this->plaintext_modding->toPlainText().toStdString());
 
     // instruct jobinfowidget to rebuild structures
-    this->widget_job_info->rebuild_structures();
+    this->widget_job_info->rebuild_structures(this->plaintext_modding->toPlainText());
 }
@@ -43,13 +43,17 @@
 #include <QComboBox>
 #include <QCheckBox>
 #include <QSpinBox>
+#include <QLineEdit>
 #include <QDoubleSpinBox>
 #include <QMap>
+#include <QHash>
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QSplitter>
 #include <QTextCursor>
 
+#include <cmath>
+
 #include "jobinfowidget.h"
 #include "threadrenderimage.h"
 #include "logwindow.h"
@@ -69,6 +73,7 @@ private:
     QPushButton* button_parse_files;
     QPushButton* button_run_single_job;
     QPushButton* button_cancel;
+    QPushButton* button_reject;
     QPushButton* button_select_folder;
     QPushButton* button_rebuild_structures;
     QProgressBar* progress_bar;
@@ -82,15 +87,37 @@ private:
     QLabel* label_custom_ortho_scale;
     QDoubleSpinBox* spinbox_custom_ortho_scale;
     QComboBox* combobox_camera_direction;
+    QLineEdit* lineedit_views;
     QCheckBox* checkbox_unitcell;
     QCheckBox* checkbox_expansion;
     QCheckBox* checkbox_axes;
     QSpinBox* spinbox_resolution_x;
     QSpinBox* spinbox_resolution_y;
+    QComboBox* combobox_output_format;
     QSpinBox* spinbox_tile_x;
     QSpinBox* spinbox_tile_y;
     QSpinBox* spinbox_samples;
+    QCheckBox* checkbox_adaptive_sampling;
+    QDoubleSpinBox* spinbox_noise_threshold;
+    QCheckBox* checkbox_denoise;
+    QSpinBox* spinbox_job_time_budget;
+    QSpinBox* spinbox_queue_deadline;
     QSpinBox* spinbox_nsubdiv;
+    QDoubleSpinBox* spinbox_lod_segment_pixels;
+    QCheckBox* checkbox_instancing;
+    QCheckBox* checkbox_animation;
+    QSpinBox* spinbox_frame_step;
+    QSpinBox* spinbox_nr_workers;
+    QComboBox* combobox_render_device;
+    QSpinBox* spinbox_threads_per_worker;
+    QSpinBox* spinbox_split_tiles;
+    QComboBox* combobox_queue_order;
+    QCheckBox* checkbox_session_mode;
+    QCheckBox* checkbox_use_cache;
+    QSpinBox* spinbox_cache_size;
+    QCheckBox* checkbox_resume;
+    QCheckBox* checkbox_draft_pass;
+    QCheckBox* checkbox_distributed;
     QComboBox* combobox_atom_material;
     QComboBox* combobox_bond_material;
     QPlainTextEdit* plaintext_modding;
@@ -106,17 +133,27 @@ private:
 
     QVector<unsigned int> job_status;
 
+    int nr_jobs_finished = 0;   // completed or failed jobs in the current run
+
+    QHash<int, double> job_progress;    // render progress of the running jobs
+
+    static const int PROGRESS_RESOLUTION = 100;    // progress bar steps per job
+
     enum {
         JOB_QUEUED,
         JOB_RUNNING,
         JOB_COMPLETED,
-        JOB_CANCELLED
+        JOB_CANCELLED,
+        JOB_FAILED,
+        JOB_DRAFTED,
+        JOB_REJECTED
     };
 
     const QStringList GEOMETRY_FILETYPES {
         "VASP Geometry (POSCAR*,CONTCAR*)",
         "ADF .log files (logfile)",
         "Gaussian .log files (*.log, *.LOG)",
+        "VASP trajectory (OUTCAR*)",
     };
 
 public:
@@ -138,6 +175,21 @@ private:
 
     QString fetch_tooltip_text(const QString& filename);
 
+    /**
+     * @brief Collect Blender settings from the settings panel
+     */
+    QMap<QString, QVariant> collect_parameters() const;
+
+    /**
+     * @brief Connect the signals of the job queue to this window
+     */
+    void connect_job_queue();
+
+    /**
+     * @brief Set the progress bar from the finished jobs and the progress of running jobs
+     */
+    void update_progress_bar();
+
 private slots:
     void slot_select_folder();
 
@@ -149,10 +201,25 @@ private slots:
 
     void slot_job_start(int jobid);
 
-    void slot_job_done(int jobid);
+    void slot_job_done(int jobid, int samples, int frames);
+
+    void slot_job_failed(int jobid);
+
+    void slot_draft_done(int jobid);
+
+    void slot_job_rejected(int jobid);
+
+    /**
+     * @brief Exclude the selected job from the final pass
+     */
+    void slot_reject_job();
+
+    void slot_job_progress(int jobid, double fraction, double eta);
 
     void slot_queue_done();
 
+    void slot_queue_eta(double seconds);
+
     void slot_probe_gpu();
 
     void slot_change_ortho_scale(int item_id);
@@ -169,6 +236,11 @@ private slots:
 
     void slot_debug_log();
 
+    /**
+     * @brief Save the per-phase timings of all jobs as CSV or JSON
+     */
+    void slot_export_timings();
+
     void slot_about();
 
     void slot_rebuild_structures();
@@ -0,0 +1,221 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include "output_stage.h"
+
+/**
+ * @brief Constructs a new instance
+ * @param _cache            render cache to store the images in; may be null
+ * @param _format           file format of the published images, e.g. "png" or "jpg"
+ * @param _quality          compression quality (0-100), -1 for the default of the format
+ * @param _thumbnail_size   longest edge of the thumbnails in pixels, zero to skip
+ * @param nr_threads        number of images processed concurrently
+ */
+OutputStage::OutputStage(RenderCache* _cache, const QString& _format, int _quality, int _thumbnail_size,
+                         int nr_threads, QObject* parent) :
+    QObject(parent),
+    cache(_cache),
+    format(get_extension(_format)),
+    quality(_quality),
+    thumbnail_size(std::max(0, _thumbnail_size)) {
+
+    if(this->format == "png" && !_format.isEmpty() && _format.toLower() != "png") {
+        qWarning() << "Image format " << _format << " is not supported, publishing PNG images";
+    }
+
+    this->pool.setMaxThreadCount(std::max(1, nr_threads));
+}
+
+OutputStage::~OutputStage() {
+    this->pool.waitForDone();
+}
+
+/**
+ * @brief File format (and extension) published images are written in
+ *
+ * Falls back to PNG for formats Qt cannot write.
+ */
+QString OutputStage::get_extension(const QString& format) {
+    QString extension = format.toLower().trimmed();
+    if(extension == "jpeg") {
+        extension = "jpg";
+    }
+
+    if(extension.isEmpty() || !QImageWriter::supportedImageFormats().contains(extension.toLatin1())) {
+        return "png";
+    }
+
+    return extension;
+}
+
+/**
+ * @brief Location of the thumbnail of a published image
+ */
+QString OutputStage::get_thumbnail_path(const QString& image) {
+    QFileInfo info(image);
+    return info.path() + "/" + info.completeBaseName() + ".thumb.png";
+}
+
+/**
+ * @brief Publish the images of a job in the background
+ * @param callback  receives the result in the thread of the stage
+ */
+void OutputStage::submit(const OutputTask& task, const std::function<void(const OutputResult&)>& callback) {
+    this->in_flight++;
+    this->pool.start([this, task, callback]() {
+        OutputResult result = this->process(task);
+        QMetaObject::invokeMethod(this, [this, callback, result]() {
+            this->in_flight--;
+            callback(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Finish all tasks and execute their callbacks
+ */
+void OutputStage::wait() {
+    this->pool.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+OutputResult OutputStage::process(const OutputTask& task) {
+    auto start = std::chrono::steady_clock::now();
+    OutputResult result;
+    QCryptographicHash output_hash(QCryptographicHash::Sha256);
+
+    for(const OutputImage& image : task.images) {
+        QImage decoded;
+        QByteArray data = this->publish(image, decoded);
+        if(data.isEmpty()) {
+            result.success = false;
+            continue;
+        }
+        output_hash.addData(data);
+
+        if(this->thumbnail_size > 0) {
+            if(decoded.isNull()) {
+                decoded.loadFromData(data);
+            }
+            this->write_thumbnail(image.dest, decoded);
+        }
+
+        // keep a copy of the image for identical future jobs
+        if(this->cache && !image.cache_key.isEmpty()) {
+            this->cache->store(image.cache_key, image.dest);
+        }
+    }
+
+    if(!task.cleanup_dir.isEmpty()) {
+        QDir(task.cleanup_dir).removeRecursively();
+    }
+
+    result.output_hash = output_hash.result();
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    result.process_time = elapsed_seconds.count();
+
+    return result;
+}
+
+/**
+ * @brief Publish a single image under its final name
+ * @return contents of the published file, empty on failure
+ */
+QByteArray OutputStage::publish(const OutputImage& image, QImage& decoded) {
+    // image has been published before, e.g. restored from the cache
+    if(image.source.isEmpty()) {
+        QFile file(image.dest);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+    QFile source(image.source);
+    if(!source.open(QIODevice::ReadOnly)) {
+        qCritical() << "Rendered image " << image.source << " is missing";
+        return QByteArray();
+    }
+    QByteArray data = source.readAll();
+    source.close();
+    QDir().mkpath(QFileInfo(image.dest).absolutePath());
+
+    if(this->format != "png") {
+        decoded.loadFromData(data, "PNG");
+        if(decoded.isNull()) {
+            qCritical() << "Could not decode " << image.source;
+            return QByteArray();
+        }
+
+        // formats without transparency get a white background rather than a black one
+        QImage encoded = decoded;
+        if(decoded.hasAlphaChannel() && (this->format == "jpg" || this->format == "bmp")) {
+            encoded = QImage(decoded.size(), QImage::Format_RGB32);
+            encoded.fill(Qt::white);
+            QPainter painter(&encoded);
+            painter.drawImage(0, 0, decoded);
+        }
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QImageWriter writer(&buffer, this->format.toLatin1());
+        writer.setQuality(this->quality);
+        if(!writer.write(encoded)) {
+            qCritical() << "Could not encode " << image.dest << ": " << writer.errorString();
+            return QByteArray();
+        }
+        data = buffer.data();
+    } else {
+#ifdef Q_OS_UNIX
+        // the job folder may reside on the same file system, move the image in place
+        if(std::rename(QFile::encodeName(image.source).constData(), QFile::encodeName(image.dest).constData()) == 0) {
+            return data;
+        }
+#endif
+    }
+
+    if(!write_file(image.dest, data)) {
+        qCritical() << "Could not store image " << image.dest;
+        return QByteArray();
+    }
+
+    return data;
+}
+
+/**
+ * @brief Write a file under its final name in a single step
+ */
+bool OutputStage::write_file(const QString& path, const QByteArray& data) {
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+void OutputStage::write_thumbnail(const QString& image_path, const QImage& image) const {
+    if(image.isNull()) {
+        qWarning() << "Could not create a thumbnail of " << image_path;
+        return;
+    }
+
+    QImage thumbnail = image.scaled(this->thumbnail_size, this->thumbnail_size,
+                                    Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if(!thumbnail.save(&buffer, "PNG") || !write_file(get_thumbnail_path(image_path), buffer.data())) {
+        qWarning() << "Could not store thumbnail of " << image_path;
+    }
+}
@@ -0,0 +1,162 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#ifndef OUTPUTSTAGE_H
+#define OUTPUTSTAGE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QPainter>
+#include <QThreadPool>
+#include <QCryptographicHash>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+#ifdef Q_OS_UNIX
+#include <cstdio>
+#endif
+
+#include "render_cache.h"
+
+/**
+ * @brief Image to publish after a render
+ */
+struct OutputImage {
+    QString source;         // rendered image in the job folder; empty when dest is already in place
+    QString dest;           // location the image is published at
+    QString cache_key;      // key to store the published image under; empty to skip the cache
+};
+
+/**
+ * @brief Images of a single job, published together
+ */
+struct OutputTask {
+    QVector<OutputImage> images;
+    QString cleanup_dir;    // job folder that is removed once the images are published
+};
+
+struct OutputResult {
+    bool success = true;
+    QByteArray output_hash;     // SHA-256 over the published images
+    double process_time = 0.0;  // time spent publishing in seconds
+};
+
+/**
+ * @brief Publishes rendered images on a thread pool
+ *
+ * Reading back, (re-)encoding, hashing, thumbnailing and caching the images
+ * of a job take a noticeable amount of time for large images and animations.
+ * The output stage performs these steps on its own threads, such that the
+ * render thread can hand the worker its next job right away. Images are
+ * published under their final name in a single step: by a rename when the
+ * job folder lies on the same file system, or via a temporary file in the
+ * destination folder otherwise.
+ *
+ * The callback of a task is executed in the thread the stage lives in, once
+ * that thread processes its events.
+ */
+class OutputStage : public QObject {
+    Q_OBJECT
+
+private:
+    QThreadPool pool;
+    RenderCache* cache;         // not owned; may be null
+    QString format;             // file format of the published images
+    int quality;                // compression quality, -1 for the default of the format
+    int thumbnail_size;         // longest edge of the thumbnails in pixels, zero to skip
+    int in_flight = 0;          // tasks whose callback has not been executed yet
+
+public:
+    /**
+     * @brief Constructs a new instance
+     * @param _cache            render cache to store the images in; may be null
+     * @param _format           file format of the published images, e.g. "png" or "jpg"
+     * @param _quality          compression quality (0-100), -1 for the default of the format
+     * @param _thumbnail_size   longest edge of the thumbnails in pixels, zero to skip
+     * @param nr_threads        number of images processed concurrently
+     */
+    OutputStage(RenderCache* _cache, const QString& _format, int _quality, int _thumbnail_size,
+                int nr_threads, QObject* parent = nullptr);
+
+    ~OutputStage();
+
+    /**
+     * @brief File format (and extension) published images are written in
+     *
+     * Falls back to PNG for formats Qt cannot write.
+     */
+    static QString get_extension(const QString& format);
+
+    /**
+     * @brief Location of the thumbnail of a published image
+     */
+    static QString get_thumbnail_path(const QString& image);
+
+    /**
+     * @brief Publish the images of a job in the background
+     * @param callback  receives the result in the thread of the stage
+     */
+    void submit(const OutputTask& task, const std::function<void(const OutputResult&)>& callback);
+
+    /**
+     * @brief Whether tasks are being processed or await their callback
+     */
+    inline bool is_busy() const {
+        return this->in_flight > 0;
+    }
+
+    /**
+     * @brief Finish all tasks and execute their callbacks
+     */
+    void wait();
+
+private:
+    OutputResult process(const OutputTask& task);
+
+    /**
+     * @brief Publish a single image under its final name
+     * @return contents of the published file, empty on failure
+     */
+    QByteArray publish(const OutputImage& image, QImage& decoded);
+
+    /**
+     * @brief Write a file under its final name in a single step
+     */
+    static bool write_file(const QString& path, const QByteArray& data);
+
+    void write_thumbnail(const QString& image_path, const QImage& image) const;
+};
+
+#endif // OUTPUTSTAGE_H
@@ -0,0 +1,128 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include "preview_cache.h"
+
+/**
+ * @brief Constructs a new instance
+ * @param max_size_mb   memory bound of the previews in megabytes
+ */
+PreviewCache::PreviewCache(int max_size_mb, QObject* parent) : QObject(parent) {
+    this->cache.setMaxCost(max_size_mb * 1024);
+    this->pool.setMaxThreadCount(1);
+}
+
+PreviewCache::~PreviewCache() {
+    this->pool.clear();
+    this->pool.waitForDone();
+}
+
+/**
+ * @brief Look up the preview of an image, decoding it in the background on a miss
+ * @param path      path to the image
+ * @param size      bounding box of the preview
+ * @param preview   receives the preview on a hit
+ * @return whether the preview was available; otherwise signal_preview_ready
+ *         or signal_preview_failed follows
+ */
+bool PreviewCache::get(const QString& path, const QSize& size, QImage& preview) {
+    QString key = get_key(path, size);
+    if(QImage* image = this->cache.object(key)) {
+        preview = *image;
+        return true;
+    }
+
+    // the previously shown images are no longer of interest
+    this->pool.clear();
+    this->requested.clear();
+    this->request(key, path, size, 1);
+
+    return false;
+}
+
+/**
+ * @brief Decode the preview of an image that is likely shown next
+ */
+void PreviewCache::prefetch(const QString& path, const QSize& size) {
+    if(!QFileInfo::exists(path)) {
+        return;
+    }
+
+    QString key = get_key(path, size);
+    if(!this->cache.contains(key)) {
+        this->request(key, path, size, 0);
+    }
+}
+
+QString PreviewCache::get_key(const QString& path, const QSize& size) {
+    return QString("%1|%2|%3x%4").arg(path)
+                                 .arg(QFileInfo(path).lastModified().toMSecsSinceEpoch())
+                                 .arg(size.width())
+                                 .arg(size.height());
+}
+
+void PreviewCache::request(const QString& key, const QString& path, const QSize& size, int priority) {
+    if(this->requested.contains(key)) {
+        return;
+    }
+    this->requested.insert(key);
+
+    this->pool.start([this, key, path, size]() {
+        QString error;
+        QImage image = decode(path, size, error);
+        QMetaObject::invokeMethod(this, [this, key, path, image, error]() {
+            this->requested.remove(key);
+            if(image.isNull()) {
+                emit(signal_preview_failed(path, error));
+                return;
+            }
+            this->cache.insert(key, new QImage(image), std::max(1, (int)(image.sizeInBytes() / 1024)));
+            emit(signal_preview_ready(path));
+        }, Qt::QueuedConnection);
+    }, priority);
+}
+
+/**
+ * @brief Read and scale an image; runs on the decoder thread
+ */
+QImage PreviewCache::decode(const QString& path, const QSize& size, QString& error) {
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    // let the image plugin reduce the image while decoding where it can (e.g. JPEG)
+    QSize full_size = reader.size();
+    if(full_size.isValid() && (full_size.width() > size.width() || full_size.height() > size.height())) {
+        reader.setScaledSize(full_size.scaled(size, Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if(image.isNull()) {
+        error = reader.errorString();
+        qWarning() << "Could not read " << path << ": " << error;
+        return image;
+    }
+
+    if(image.width() > size.width() || image.height() > size.height()) {
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return image;
+}
@@ -0,0 +1,105 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#ifndef PREVIEWCACHE_H
+#define PREVIEWCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QImage>
+#include <QImageReader>
+#include <QSize>
+#include <QSet>
+#include <QString>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThreadPool>
+#include <QDebug>
+
+#include <algorithm>
+
+/**
+ * @brief Size-bounded cache of downscaled renders for the preview pane
+ *
+ * Decoding and rescaling a large render takes far longer than switching
+ * between jobs. Previews are therefore decoded on a background thread and
+ * kept in memory, keyed on the path, the modification time and the size of
+ * the preview, such that a re-rendered image is never shown stale. When the
+ * memory bound is exceeded, the least recently used previews are dropped.
+ *
+ * Requests for the image that is shown take precedence over prefetches;
+ * pending requests are dropped when another image is shown.
+ */
+class PreviewCache : public QObject {
+    Q_OBJECT
+
+private:
+    QCache<QString, QImage> cache;      // cost in kilobytes
+    QThreadPool pool;                   // single decoder thread
+    QSet<QString> requested;            // keys queued for decoding
+
+public:
+    /**
+     * @brief Constructs a new instance
+     * @param max_size_mb   memory bound of the previews in megabytes
+     */
+    explicit PreviewCache(int max_size_mb = 256, QObject* parent = nullptr);
+
+    ~PreviewCache();
+
+    /**
+     * @brief Look up the preview of an image, decoding it in the background on a miss
+     * @param path      path to the image
+     * @param size      bounding box of the preview
+     * @param preview   receives the preview on a hit
+     * @return whether the preview was available; otherwise signal_preview_ready
+     *         or signal_preview_failed follows
+     */
+    bool get(const QString& path, const QSize& size, QImage& preview);
+
+    /**
+     * @brief Decode the preview of an image that is likely shown next
+     */
+    void prefetch(const QString& path, const QSize& size);
+
+signals:
+    /**
+     * @brief A preview requested via get() or prefetch() has been decoded
+     */
+    void signal_preview_ready(const QString& path);
+
+    /**
+     * @brief An image requested via get() or prefetch() could not be decoded
+     */
+    void signal_preview_failed(const QString& path, const QString& error);
+
+private:
+    static QString get_key(const QString& path, const QSize& size);
+
+    void request(const QString& key, const QString& path, const QSize& size, int priority);
+
+    /**
+     * @brief Read and scale an image; runs on the decoder thread
+     */
+    static QImage decode(const QString& path, const QSize& size, QString& error);
+};
+
+#endif // PREVIEWCACHE_H
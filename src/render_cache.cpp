@@ -0,0 +1,167 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#include "render_cache.h"
+
+/**
+ * @brief Constructs a new instance.
+ * @param _max_size  maximum size of the cache in bytes
+ * @param _cache_dir folder holding the cache; empty for the default location
+ */
+RenderCache::RenderCache(qint64 _max_size, const QString& _cache_dir) :
+    cache_dir(_cache_dir.isEmpty() ? RenderCache::default_location() : _cache_dir),
+    max_size(_max_size) {
+
+    if(!QDir().mkpath(this->cache_dir)) {
+        qWarning() << "Could not create render cache folder: " << this->cache_dir;
+    }
+}
+
+/**
+ * @brief Default location of the render cache
+ */
+QString RenderCache::default_location() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/" + PROGRAM_NAME_LC + "/renders";
+}
+
+/**
+ * @brief Hash over the Blender assets shipped in the resource bundle
+ */
+QByteArray RenderCache::hash_assets() {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for(const QString& asset : {":/assets/blender/render_image.py",
+                                ":/assets/blender/axes_template.blend",
+                                ":/assets/configuration/atoms.json"}) {
+        QFile file(asset);
+        if(!file.open(QIODevice::ReadOnly)) {
+            throw std::runtime_error("Could not open " + asset.toStdString() + " from assets.");
+        }
+        hash.addData(&file);
+    }
+
+    return hash.result();
+}
+
+/**
+ * @brief Build the cache key of a render job
+ * @param asset_hash    result of hash_assets()
+ * @param atompack      contents of atompack.bin
+ * @param manifest      contents of manifest.json
+ */
+QString RenderCache::get_key(const QByteArray& asset_hash, const QByteArray& atompack, const QByteArray& manifest) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(asset_hash);
+    hash.addData(QCryptographicHash::hash(atompack, QCryptographicHash::Sha256));
+    hash.addData(QCryptographicHash::hash(manifest, QCryptographicHash::Sha256));
+
+    return hash.result().toHex();
+}
+
+/**
+ * @brief Restore a cached image
+ * @param key   cache key
+ * @param dest  path to write the image to
+ * @return whether the key was present in the cache
+ */
+bool RenderCache::fetch(const QString& key, const QString& dest) const {
+    QMutexLocker lock(&this->mutex);
+    QFile entry(this->get_entry_path(key, QFileInfo(dest).suffix()));
+    if(!entry.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    // replace an existing image in a single step such that it is never
+    // missing or partially written
+    QByteArray data = entry.readAll();
+    QSaveFile out(dest);
+    if(!out.open(QIODevice::WriteOnly) || out.write(data) != data.size() || !out.commit()) {
+        qWarning() << "Could not restore " << dest << " from render cache";
+        return false;
+    }
+
+    // mark as recently used
+    entry.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    return true;
+}
+
+/**
+ * @brief Store a rendered image and evict the least recently used entries
+ * @param key   cache key
+ * @param image path to the rendered image
+ */
+void RenderCache::store(const QString& key, const QString& image) {
+    QMutexLocker lock(&this->mutex);
+
+    // copy under a temporary name first such that another instance sharing
+    // the cache never observes a partially written entry
+    QString entry_path = this->get_entry_path(key, QFileInfo(image).suffix());
+    QString partial_path = entry_path + ".part";
+    QFile::remove(partial_path);
+    if(!QFile::copy(image, partial_path)) {
+        qWarning() << "Could not store " << image << " in render cache";
+        return;
+    }
+    QFile::remove(entry_path);
+    QFile::rename(partial_path, entry_path);
+
+    this->evict();
+}
+
+/**
+ * @brief Path of the entry of a key in a format, e.g. <key>.jpg
+ */
+QString RenderCache::get_entry_path(const QString& key, const QString& extension) const {
+    return this->cache_dir + "/" + key + (extension.isEmpty() ? QString() : "." + extension.toLower());
+}
+
+/**
+ * @brief Remove the least recently used entries; the caller holds the mutex
+ *
+ * Partial entries left behind by an interrupted store count towards the
+ * size as well and are removed once they are older than an hour, as they
+ * can never be fetched.
+ */
+void RenderCache::evict() {
+    QDir dir(this->cache_dir);
+    QFileInfoList entries = dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    QDateTime stale = QDateTime::currentDateTime().addSecs(-3600);
+
+    qint64 total_size = 0;
+    for(int i=entries.size()-1; i>=0; i--) {
+        const QFileInfo& entry = entries[i];
+        if(entry.suffix() == "part" && entry.lastModified() < stale) {
+            QFile::remove(entry.absoluteFilePath());
+            qDebug() << "Removing partial entry " << entry.fileName() << " from render cache";
+            entries.removeAt(i);
+            continue;
+        }
+        total_size += entry.size();
+    }
+
+    // entries are sorted from least to most recently used
+    for(const QFileInfo& entry : entries) {
+        if(total_size <= this->max_size) {
+            break;
+        }
+        total_size -= entry.size();
+        QFile::remove(entry.absoluteFilePath());
+        qDebug() << "Evicting " << entry.fileName() << " from render cache";
+    }
+}
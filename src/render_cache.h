@@ -0,0 +1,110 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "config.h"
+
+/**
+ * @brief Content-addressed store of rendered images
+ *
+ * Images are stored under a key that hashes the atompack, the manifest and
+ * the Blender assets (render_image.py, template and atoms.json), such that
+ * a byte-identical job can be restored without launching Blender. The
+ * modification time of an entry doubles as its last access time for LRU
+ * eviction once the total size exceeds the cap. Entries keep the extension
+ * of the image, such that the formats of a job are cached side by side.
+ *
+ * Entries are fetched by the render thread and stored by the threads of the
+ * output stage, hence all access goes through a mutex.
+ */
+class RenderCache {
+private:
+    QString cache_dir;
+    qint64 max_size;            // maximum size of the cache in bytes
+    mutable QMutex mutex;       // guards the entries against concurrent fetch, store and eviction
+
+public:
+    /**
+     * @brief Constructs a new instance.
+     * @param _max_size  maximum size of the cache in bytes
+     * @param _cache_dir folder holding the cache; empty for the default location
+     */
+    RenderCache(qint64 _max_size, const QString& _cache_dir = QString());
+
+    /**
+     * @brief Default location of the render cache
+     */
+    static QString default_location();
+
+    /**
+     * @brief Hash over the Blender assets shipped in the resource bundle
+     */
+    static QByteArray hash_assets();
+
+    /**
+     * @brief Build the cache key of a render job
+     * @param asset_hash    result of hash_assets()
+     * @param atompack      contents of atompack.bin
+     * @param manifest      contents of manifest.json
+     */
+    static QString get_key(const QByteArray& asset_hash, const QByteArray& atompack, const QByteArray& manifest);
+
+    /**
+     * @brief Restore a cached image
+     * @param key   cache key
+     * @param dest  path to write the image to; its extension selects the format
+     * @return whether the key was present in the cache
+     */
+    bool fetch(const QString& key, const QString& dest) const;
+
+    /**
+     * @brief Store a rendered image and evict the least recently used entries
+     * @param key   cache key
+     * @param image path to the rendered image
+     */
+    void store(const QString& key, const QString& image);
+
+private:
+    /**
+     * @brief Path of the entry of a key in a format, e.g. <key>.jpg
+     */
+    QString get_entry_path(const QString& key, const QString& extension) const;
+
+    /**
+     * @brief Remove the least recently used entries; the caller holds the mutex
+     */
+    void evict();
+};
+
+#endif // RENDERCACHE_H
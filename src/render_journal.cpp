@@ -0,0 +1,173 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#include "render_journal.h"
+
+/**
+ * @brief Open (or create) the journal in a data folder and replay it
+ * @param _folder   data folder
+ * @param filename  name of the journal file within the data folder
+ */
+RenderJournal::RenderJournal(const QString& _folder, const QString& filename) :
+    folder(QDir::cleanPath(_folder)),
+    file(QDir::cleanPath(_folder) + "/" + filename) {
+
+    bool terminated = this->replay();
+    if(this->compact()) {
+        terminated = true;
+    }
+
+    if(!this->file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        throw std::runtime_error("Could not open journal " + this->file.fileName().toStdString());
+    }
+
+    // records are never appended to the truncated line of a crash
+    if(!terminated) {
+        this->file.write("\n");
+        this->file.flush();
+    }
+}
+
+/**
+ * @brief Append a state change of a job to the journal
+ * @param path      path to the geometry file of the job
+ * @param state     one of queued, running, done, failed
+ * @param data      additional fields (hashes, timings)
+ */
+void RenderJournal::record(const QString& path, const QString& state, const QJsonObject& data) {
+    QJsonObject entry = data;
+    entry["file"] = this->get_key(path);
+    entry["state"] = state;
+    entry["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+
+    this->file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n");
+    this->file.flush();
+#ifdef Q_OS_UNIX
+    ::fsync(this->file.handle());
+#endif
+
+    this->apply(entry);
+}
+
+/**
+ * @brief Last known record of a job, empty when the job is unknown
+ */
+QJsonObject RenderJournal::get_state(const QString& path) const {
+    return this->states.value(this->get_key(path));
+}
+
+/**
+ * @brief Last done record of a job, empty when the job has never been completed
+ */
+QJsonObject RenderJournal::get_done(const QString& path) const {
+    return this->completed.value(this->get_key(path));
+}
+
+/**
+ * @brief Whether a job has been completed with the same input
+ * @param path          path to the geometry file of the job
+ * @param input_hash    hash over the inputs of the job
+ */
+bool RenderJournal::is_done(const QString& path, const QString& input_hash) const {
+    // later records (queued, running) of this or another run do not undo a completion
+    QJsonObject done = this->get_done(path);
+    return !done.isEmpty() && done["input_hash"].toString() == input_hash;
+}
+
+/**
+ * @brief Load the records of the journal file
+ * @return whether the file ends with a complete line
+ */
+bool RenderJournal::replay() {
+    QFile infile(this->file.fileName());
+    if(!infile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return true;
+    }
+
+    bool terminated = true;
+    while(!infile.atEnd()) {
+        // a crash may leave a truncated last line, which is skipped
+        QByteArray line = infile.readLine();
+        terminated = line.endsWith('\n');
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if(!doc.isObject()) {
+            continue;
+        }
+        this->apply(doc.object());
+        this->nr_records++;
+    }
+
+    qDebug() << "Replayed " << this->nr_records << " journal records for " << this->states.size() << " jobs";
+
+    return terminated;
+}
+
+/**
+ * @brief Rewrite the journal file with the last record and last done record of every job
+ * @return whether the journal file has been replaced
+ *
+ * Every run appends a record per job, hence the journal grows without bound
+ * unless the superseded records are dropped. The compacted journal replays
+ * to the same states and is replaced in a single step, such that a crash
+ * during compaction leaves the original journal intact.
+ */
+bool RenderJournal::compact() {
+    QStringList keys = this->states.keys();
+    keys.sort();
+
+    QByteArray contents;
+    unsigned int nr_compacted = 0;
+    for(const QString& key : keys) {
+        // the done record precedes the last record, such that a replay ends at the latter
+        const QJsonObject& state = this->states[key];
+        if(this->completed.contains(key) && this->completed[key] != state) {
+            contents += QJsonDocument(this->completed[key]).toJson(QJsonDocument::Compact) + "\n";
+            nr_compacted++;
+        }
+        contents += QJsonDocument(state).toJson(QJsonDocument::Compact) + "\n";
+        nr_compacted++;
+    }
+
+    if(nr_compacted >= this->nr_records) {
+        return false;
+    }
+
+    QSaveFile out(this->file.fileName());
+    if(!out.open(QIODevice::WriteOnly) || out.write(contents) != contents.size() || !out.commit()) {
+        qWarning() << "Could not compact journal " << this->file.fileName();
+        return false;
+    }
+
+    qDebug() << "Compacted journal from " << this->nr_records << " to " << nr_compacted << " records";
+    this->nr_records = nr_compacted;
+
+    return true;
+}
+
+void RenderJournal::apply(const QJsonObject& entry) {
+    QString key = entry["file"].toString();
+    this->states[key] = entry;
+    if(entry["state"].toString() == "done") {
+        this->completed[key] = entry;
+    }
+}
+
+QString RenderJournal::get_key(const QString& path) const {
+    return QDir(this->folder).relativeFilePath(path);
+}
@@ -0,0 +1,111 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#ifndef RENDERJOURNAL_H
+#define RENDERJOURNAL_H
+
+#include <QString>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Write-ahead journal of the render queue
+ *
+ * Every state change of a job (queued, running, done, failed) is appended as
+ * a single JSON line to a journal file in the data folder and flushed to disk
+ * before the corresponding action is taken. Replaying the journal yields the
+ * last known state of every job, which allows a queue to be resumed after a
+ * crash of the program or the machine.
+ *
+ * As every run queues its jobs again, the last completion of a job is kept
+ * apart from its last record; a resumed queue skips a job based on the former.
+ * On opening, the journal is compacted to these two records per job.
+ */
+class RenderJournal {
+private:
+    QString folder;
+    QFile file;
+    QHash<QString, QJsonObject> states;     // last record per job, keyed on relative path
+    QHash<QString, QJsonObject> completed;  // last done record per job, keyed on relative path
+    unsigned int nr_records = 0;            // number of records in the journal file
+
+public:
+    static constexpr const char* FILENAME = "slabrender_journal.jsonl";
+
+    /**
+     * @brief Open (or create) the journal in a data folder and replay it
+     * @param _folder   data folder
+     * @param filename  name of the journal file within the data folder
+     */
+    RenderJournal(const QString& _folder, const QString& filename = FILENAME);
+
+    /**
+     * @brief Append a state change of a job to the journal
+     * @param path      path to the geometry file of the job
+     * @param state     one of queued, running, done, failed
+     * @param data      additional fields (hashes, timings)
+     */
+    void record(const QString& path, const QString& state, const QJsonObject& data = QJsonObject());
+
+    /**
+     * @brief Last known record of a job, empty when the job is unknown
+     */
+    QJsonObject get_state(const QString& path) const;
+
+    /**
+     * @brief Last done record of a job, empty when the job has never been completed
+     */
+    QJsonObject get_done(const QString& path) const;
+
+    /**
+     * @brief Whether a job has been completed with the same input
+     * @param path          path to the geometry file of the job
+     * @param input_hash    hash over the inputs of the job
+     */
+    bool is_done(const QString& path, const QString& input_hash) const;
+
+private:
+    /**
+     * @brief Load the records of the journal file
+     * @return whether the file ends with a complete line
+     */
+    bool replay();
+
+    /**
+     * @brief Rewrite the journal file with the last record and last done record of every job
+     * @return whether the journal file has been replaced
+     */
+    bool compact();
+
+    void apply(const QJsonObject& entry);
+
+    QString get_key(const QString& path) const;
+};
+
+#endif // RENDERJOURNAL_H
@@ -0,0 +1,412 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#include "render_worker.h"
+
+RenderWorker::RenderWorker(QObject* parent) : QObject(parent) {
+    this->timer_timeout = new QTimer(this);
+    this->timer_timeout->setSingleShot(true);
+    connect(this->timer_timeout, &QTimer::timeout, this, &RenderWorker::slot_timeout);
+}
+
+RenderWorker::~RenderWorker() {
+    this->kill();
+}
+
+/**
+ * @brief Launch a job; the worker takes ownership of the process
+ * @param _jobid    job id
+ * @param _process  fully configured (but not yet started) process
+ * @param _part     tile of the job, -1 for the whole image
+ */
+void RenderWorker::launch(int _jobid, QProcess* _process, int _part) {
+    this->reset_job(_jobid, _part);
+    this->process = _process;
+    this->process->setParent(this);
+    this->working_directory = this->process->workingDirectory();
+
+    connect(this->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &RenderWorker::slot_process_finished);
+    connect(this->process, &QProcess::errorOccurred, this, &RenderWorker::slot_process_error, Qt::QueuedConnection);
+    connect(this->process, &QProcess::readyReadStandardOutput, this, &RenderWorker::slot_read_stdout);
+    connect(this->process, &QProcess::readyReadStandardError, this, &RenderWorker::slot_read_stderr);
+
+    this->start = std::chrono::steady_clock::now();
+    this->timer_timeout->start(this->timeout * 1000);
+    this->process->start();
+    qDebug() << "Blender process launched for job " << this->jobid;
+}
+
+/**
+ * @brief Hand a job to the resident Blender session
+ * @param _jobid    job id
+ * @param cwd       job directory holding manifest.json and atompack.bin
+ * @param _part     tile of the job, -1 for the whole image
+ */
+void RenderWorker::submit(int _jobid, const QString& cwd, int _part) {
+    if(this->process == nullptr) {
+        this->start_session();
+    }
+
+    this->reset_job(_jobid, _part);
+    this->working_directory = cwd;
+
+    QJsonObject request;
+    request["manifest"] = cwd + "/manifest.json";
+    request["atompack"] = cwd + "/atompack.bin";
+    request["output"] = cwd + "/image.png";
+
+    this->start = std::chrono::steady_clock::now();
+    this->timer_timeout->start(this->timeout * 1000);
+
+    // writes are buffered by QProcess until the session has started
+    this->process->write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+    qDebug() << "Job " << this->jobid << " submitted to Blender session";
+}
+
+/**
+ * @brief Kill the live process without reporting the job as finished
+ */
+void RenderWorker::kill() {
+    this->timer_timeout->stop();
+    if(this->process != nullptr) {
+        this->process->disconnect(this);
+        if(this->process->state() != QProcess::NotRunning) {
+            qDebug() << "Killing Blender process of job " << this->jobid;
+            this->process->kill();
+            this->process->waitForFinished(1000);
+        }
+        if(this->session_mode) {
+            QDir(this->process->workingDirectory()).removeRecursively();
+        }
+        delete this->process;
+        this->process = nullptr;
+    }
+    this->jobid = -1;
+}
+
+void RenderWorker::start_session() {
+    this->process = this->session_factory();
+    this->process->setParent(this);
+
+    connect(this->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &RenderWorker::slot_process_finished);
+    connect(this->process, &QProcess::errorOccurred, this, &RenderWorker::slot_process_error, Qt::QueuedConnection);
+    connect(this->process, &QProcess::readyReadStandardOutput, this, &RenderWorker::slot_read_stdout);
+    connect(this->process, &QProcess::readyReadStandardError, this, &RenderWorker::slot_read_stderr);
+
+    this->process->start();
+    qDebug() << "Blender session launched";
+}
+
+/**
+ * @brief Drop the current process; the next session job starts a fresh one
+ */
+void RenderWorker::release_process() {
+    this->process->disconnect(this);
+    if(this->session_mode) {
+        QDir(this->process->workingDirectory()).removeRecursively();
+    }
+    this->process->deleteLater();
+    this->process = nullptr;
+}
+
+/**
+ * @brief Store whatever output is left after the process has terminated
+ */
+void RenderWorker::collect_output() {
+    // complete lines have already been consumed by the read handlers
+    auto lines = this->process->readAllStandardOutput().split('\n');
+    lines += this->process->readAllStandardError().split('\n');
+    for(const QByteArray& line : lines) {
+        if(!line.trimmed().isEmpty()) {
+            this->process_line(line.trimmed());
+        }
+    }
+}
+
+void RenderWorker::reset_job(int _jobid, int _part) {
+    this->jobid = _jobid;
+    this->part = _part;
+    this->output.clear();
+    this->process_time = 0.0;
+    this->timed_out = false;
+    this->progress = 0.0;
+    this->sample = -1;
+    this->min_samples = -1;
+    this->last_line_progress = false;
+    this->timings.clear();
+}
+
+/**
+ * @brief Samples rendered in the most recent job according to Cycles, -1 when unknown
+ *
+ * Lower than the configured samples when Cycles stopped at its time limit.
+ * For jobs with several renders (views, frames), the smallest count is reported.
+ */
+int RenderWorker::get_samples() const {
+    if(this->min_samples < 0 || this->sample < 0) {
+        return std::max(this->min_samples, this->sample);
+    }
+
+    return std::min(this->min_samples, this->sample);
+}
+
+/**
+ * @brief Store a line of output and extract the render progress from it
+ */
+void RenderWorker::process_line(const QString& line) {
+    if(this->parse_timing(line)) {
+        this->output << line;
+        this->last_line_progress = false;
+        return;
+    }
+
+    double fraction = parse_progress(line);
+    if(fraction < 0.0) {
+        this->output << line;
+        this->last_line_progress = false;
+        return;
+    }
+
+    // Cycles prints a line per sample, only the most recent one is of interest
+    if(this->last_line_progress) {
+        this->output.last() = line;
+    } else {
+        this->output << line;
+    }
+    this->last_line_progress = true;
+
+    if(!this->is_busy()) {
+        return;
+    }
+
+    int sample = parse_sample(line);
+    if(sample >= 0) {
+        // the counter starts over for every view, frame and tile
+        if(sample < this->sample) {
+            this->min_samples = this->min_samples < 0 ? this->sample : std::min(this->min_samples, this->sample);
+        }
+        this->sample = sample;
+    }
+
+    if(fraction == this->progress) {
+        return;
+    }
+    this->progress = fraction;
+
+    double eta = parse_remaining(line);
+    if(eta < 0.0 && fraction > 0.0) {
+        // extrapolate from the elapsed time when Cycles does not provide an estimate
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->start;
+        eta = elapsed.count() * (1.0 - fraction) / fraction;
+    }
+
+    emit(signal_job_progress(this->jobid, fraction, eta));
+}
+
+/**
+ * @brief Record the phase timings reported by render_image.py
+ *
+ * The time until render_image.py reports the start of the job is the startup
+ * time of Blender; in session mode it only covers resetting the scene after
+ * the first job.
+ *
+ * @return whether the line is a timing marker
+ */
+bool RenderWorker::parse_timing(const QString& line) {
+    static const QRegularExpression regex_timing("^SLABRENDER_TIMING (\\w+) ([\\d.eE+-]+)");
+
+    if(!this->is_busy()) {
+        return false;
+    }
+
+    if(line.startsWith("SLABRENDER_JOB_START")) {
+        this->timings["startup"] = this->get_elapsed_time();
+        return true;
+    }
+
+    QRegularExpressionMatch match = regex_timing.match(line);
+    if(!match.hasMatch()) {
+        return false;
+    }
+    this->timings[match.captured(1)] += match.captured(2).toDouble();
+
+    return true;
+}
+
+/**
+ * @brief Fraction of the render that is done according to a line of Cycles output
+ *
+ * Cycles reports lines such as "... | Remaining:00:10.45 | ... | Sample 32/128".
+ * When the image is rendered in tiles, the tile counter is taken into account.
+ *
+ * @return fraction or a negative value when the line holds no progress
+ */
+double RenderWorker::parse_progress(const QString& line) {
+    static const QRegularExpression regex_sample("Sample (\\d+)/(\\d+)");
+    static const QRegularExpression regex_tile("(?:Tile (\\d+)/(\\d+))|(?:(\\d+)/(\\d+) Tiles)");
+
+    QRegularExpressionMatch match = regex_sample.match(line);
+    if(!match.hasMatch()) {
+        return -1.0;
+    }
+
+    double nr_samples = match.captured(2).toDouble();
+    if(nr_samples <= 0.0) {
+        return -1.0;
+    }
+    double fraction = std::clamp(match.captured(1).toDouble() / nr_samples, 0.0, 1.0);
+
+    QRegularExpressionMatch match_tile = regex_tile.match(line);
+    if(match_tile.hasMatch()) {
+        bool tile_first = !match_tile.captured(1).isEmpty();
+        double tile = match_tile.captured(tile_first ? 1 : 3).toDouble();
+        double nr_tiles = match_tile.captured(tile_first ? 2 : 4).toDouble();
+        if(nr_tiles > 0.0 && tile >= 1.0) {
+            fraction = std::clamp((tile - 1.0 + fraction) / nr_tiles, 0.0, 1.0);
+        }
+    }
+
+    return fraction;
+}
+
+/**
+ * @brief Remaining render time in seconds reported in a line of Cycles output
+ * @return seconds or a negative value when the line holds no estimate
+ */
+double RenderWorker::parse_remaining(const QString& line) {
+    static const QRegularExpression regex_remaining("Remaining:\\s*([\\d:.]+)");
+
+    QRegularExpressionMatch match = regex_remaining.match(line);
+    if(!match.hasMatch()) {
+        return -1.0;
+    }
+
+    // formatted as [hh:]mm:ss.ss
+    double seconds = 0.0;
+    for(const QString& field : match.captured(1).split(':')) {
+        seconds = seconds * 60.0 + field.toDouble();
+    }
+
+    return seconds;
+}
+
+/**
+ * @brief Number of samples rendered according to a line of Cycles output
+ * @return samples or -1 when the line holds no sample counter
+ */
+int RenderWorker::parse_sample(const QString& line) {
+    static const QRegularExpression regex_sample("Sample (\\d+)/(\\d+)");
+
+    QRegularExpressionMatch match = regex_sample.match(line);
+    if(!match.hasMatch()) {
+        return -1;
+    }
+
+    return match.captured(1).toInt();
+}
+
+void RenderWorker::finish(bool success) {
+    this->timer_timeout->stop();
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - this->start;
+    this->process_time = elapsed_seconds.count();
+
+    // the receiver is allowed to launch the next job on this worker
+    // from within the signal handler
+    int finished_jobid = this->jobid;
+    this->jobid = -1;
+
+    emit(signal_job_finished(finished_jobid, success));
+}
+
+void RenderWorker::slot_process_finished(int exit_code, QProcess::ExitStatus exit_status) {
+    if(this->timed_out) {
+        qCritical() << "Process did not finish";
+    }
+
+    if(this->session_mode) {
+        qWarning() << "Blender session terminated with exit code " << exit_code << ", restarting on next job";
+        this->collect_output();
+        this->release_process();
+        if(this->is_busy()) {
+            this->finish(false);
+        }
+        return;
+    }
+
+    qDebug() << "Blender process finished for job " << this->jobid << " with exit code " << exit_code;
+    this->collect_output();
+    this->release_process();
+
+    // Blender reports a failing render script through its exit code
+    bool success = exit_status == QProcess::NormalExit && exit_code == 0 && !this->timed_out;
+    if(exit_status == QProcess::NormalExit && exit_code != 0) {
+        qCritical() << "Blender process of job " << this->jobid << " failed with exit code " << exit_code;
+    }
+    this->finish(success);
+}
+
+void RenderWorker::slot_process_error(QProcess::ProcessError error) {
+    // queued, such that a failing start() never re-enters launch() or submit();
+    // ignore notifications of processes that have since been released
+    if(this->process == nullptr || this->sender() != this->process) {
+        return;
+    }
+
+    // all other errors are followed by a finished signal
+    if(error == QProcess::FailedToStart) {
+        qCritical() << "Process did not launch";
+        qCritical() << this->process->errorString();
+        this->release_process();
+        if(this->is_busy()) {
+            this->finish(false);
+        }
+    }
+}
+
+/**
+ * @brief Consume stdout line by line; in session mode this includes the job completion marker
+ */
+void RenderWorker::slot_read_stdout() {
+    this->process->setReadChannel(QProcess::StandardOutput);
+    while(this->process != nullptr && this->process->canReadLine()) {
+        QString line = this->process->readLine().trimmed();
+        this->process_line(line);
+        if(this->session_mode && line.startsWith("SLABRENDER_JOB_DONE") && this->is_busy()) {
+            this->finish(line.endsWith(" ok"));
+        }
+    }
+}
+
+void RenderWorker::slot_read_stderr() {
+    this->process->setReadChannel(QProcess::StandardError);
+    while(this->process != nullptr && this->process->canReadLine()) {
+        this->process_line(this->process->readLine().trimmed());
+    }
+}
+
+void RenderWorker::slot_timeout() {
+    if(this->process != nullptr) {
+        this->timed_out = true;
+        this->process->kill();
+    }
+}
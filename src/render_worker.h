@@ -0,0 +1,250 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+#ifndef RENDERWORKER_H
+#define RENDERWORKER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QStringList>
+#include <QDir>
+#include <QRegularExpression>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QMap>
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+/**
+ * @brief Worker slot of the render pool
+ *
+ * A worker owns at most a single live Blender process. Completion is reported
+ * via signal_job_finished together with the job id, such that the queue can
+ * handle jobs that finish in arbitrary order.
+ *
+ * In session mode the Blender process stays resident and receives its jobs
+ * over stdin. A crashed session is restarted when the next job arrives.
+ *
+ * Output is consumed line by line while Blender runs. The sample counters
+ * printed by Cycles are turned into signal_job_progress; consecutive progress
+ * lines are collapsed into the most recent one to bound the stored output.
+ * The timing markers of render_image.py are collected per job, together with
+ * the time Blender took to start the job.
+ */
+class RenderWorker : public QObject
+{
+    Q_OBJECT
+private:
+    QProcess* process = nullptr;        // process of the current job or the resident session
+    QTimer* timer_timeout = nullptr;
+
+    bool session_mode = false;
+    std::function<QProcess*()> session_factory;
+
+    int jobid = -1;
+    int part = -1;                      // tile of the current job, -1 when the whole image is rendered
+    QString working_directory;
+    QStringList output;
+    double process_time = 0.0;
+    bool timed_out = false;
+    int timeout = 60 * 60;              // maximum duration of a job in seconds
+    double progress = 0.0;              // fraction of the current job that is rendered
+    int sample = -1;                    // last sample reported for the render in progress
+    int min_samples = -1;               // fewest samples of the earlier renders (views, frames) of the job
+    bool last_line_progress = false;    // whether the last stored line is a progress line
+    QMap<QString, double> timings;      // seconds per phase of the current job
+
+    std::chrono::time_point<std::chrono::steady_clock> start;
+
+public:
+    explicit RenderWorker(QObject* parent = nullptr);
+
+    ~RenderWorker();
+
+    /**
+     * @brief Switch the worker to session mode
+     * @param factory   builds a (not yet started) resident Blender process
+     */
+    inline void set_session_factory(const std::function<QProcess*()>& factory) {
+        this->session_factory = factory;
+        this->session_mode = true;
+    }
+
+    /**
+     * @brief Set the maximum duration of the next job in seconds
+     */
+    inline void set_timeout(int seconds) {
+        this->timeout = seconds;
+    }
+
+    inline bool is_session() const {
+        return this->session_mode;
+    }
+
+    inline bool is_busy() const {
+        return this->jobid >= 0;
+    }
+
+    inline int get_jobid() const {
+        return this->jobid;
+    }
+
+    /**
+     * @brief Tile of the current or most recent job, -1 when the whole image is rendered
+     */
+    inline int get_part() const {
+        return this->part;
+    }
+
+    /**
+     * @brief Output (stdout and stderr) of the most recent job
+     */
+    inline const QStringList& get_output() const {
+        return this->output;
+    }
+
+    /**
+     * @brief Wall clock time in seconds of the most recent job
+     */
+    inline double get_process_time() const {
+        return this->process_time;
+    }
+
+    /**
+     * @brief Seconds per phase of the most recent job: startup, scene_build and render
+     */
+    inline const QMap<QString, double>& get_timings() const {
+        return this->timings;
+    }
+
+    /**
+     * @brief Samples rendered in the most recent job according to Cycles, -1 when unknown
+     *
+     * Lower than the configured samples when Cycles stopped at its time limit.
+     * For jobs with several renders (views, frames), the smallest count is reported.
+     */
+    int get_samples() const;
+
+    /**
+     * @brief Wall clock time in seconds since the current job was started
+     */
+    inline double get_elapsed_time() const {
+        std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - this->start;
+        return elapsed_seconds.count();
+    }
+
+    /**
+     * @brief Working directory of the current or most recent job
+     */
+    inline const QString& get_working_directory() const {
+        return this->working_directory;
+    }
+
+    /**
+     * @brief Launch a job; the worker takes ownership of the process
+     * @param _jobid    job id
+     * @param _process  fully configured (but not yet started) process
+     * @param _part     tile of the job, -1 for the whole image
+     */
+    void launch(int _jobid, QProcess* _process, int _part = -1);
+
+    /**
+     * @brief Hand a job to the resident Blender session
+     * @param _jobid    job id
+     * @param cwd       job directory holding manifest.json and atompack.bin
+     * @param _part     tile of the job, -1 for the whole image
+     */
+    void submit(int _jobid, const QString& cwd, int _part = -1);
+
+    /**
+     * @brief Kill the live process without reporting the job as finished
+     */
+    void kill();
+
+    /**
+     * @brief Fraction of the render that is done according to a line of Cycles output
+     * @return fraction or a negative value when the line holds no progress
+     */
+    static double parse_progress(const QString& line);
+
+    /**
+     * @brief Remaining render time in seconds reported in a line of Cycles output
+     * @return seconds or a negative value when the line holds no estimate
+     */
+    static double parse_remaining(const QString& line);
+
+    /**
+     * @brief Number of samples rendered according to a line of Cycles output
+     * @return samples or -1 when the line holds no sample counter
+     */
+    static int parse_sample(const QString& line);
+
+private:
+    void start_session();
+
+    void release_process();
+
+    void collect_output();
+
+    void finish(bool success);
+
+    /**
+     * @brief Reset the per-job state at the start of a job
+     */
+    void reset_job(int _jobid, int _part);
+
+    /**
+     * @brief Store a line of output and extract the render progress from it
+     */
+    void process_line(const QString& line);
+
+    /**
+     * @brief Record the phase timings reported by render_image.py
+     * @return whether the line is a timing marker
+     */
+    bool parse_timing(const QString& line);
+
+private slots:
+    void slot_process_finished(int exit_code, QProcess::ExitStatus exit_status);
+
+    void slot_process_error(QProcess::ProcessError error);
+
+    void slot_read_stdout();
+
+    void slot_read_stderr();
+
+    void slot_timeout();
+
+signals:
+    void signal_job_finished(int jobid, bool success);
+
+    /**
+     * @brief Progress of a running job
+     * @param jobid     job id
+     * @param fraction  fraction of the render that is done
+     * @param eta       estimated remaining time in seconds
+     */
+    void signal_job_progress(int jobid, double fraction, double eta);
+};
+
+#endif // RENDERWORKER_H
@@ -0,0 +1,157 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include "staging_area.h"
+
+/**
+ * @brief Extract the assets, unless another process already did so
+ * @param asset_hash    hash over the assets (see RenderCache::hash_assets)
+ * @param _root         folder to stage in; empty for the default location
+ */
+StagingArea::StagingArea(const QByteArray& asset_hash, const QString& _root) :
+    root(_root.isEmpty() ? StagingArea::default_location() : QDir::cleanPath(_root)) {
+
+    if(!QDir().mkpath(this->root)) {
+        throw std::runtime_error("Could not create staging folder " + this->root.toStdString());
+    }
+    this->remove_stale_dirs();
+
+    this->asset_dir = this->root + "/assets-" + asset_hash.toHex().left(16);
+    if(QFile::exists(this->get_script_path())) {
+        qDebug() << "Using staged assets in " << this->asset_dir;
+        return;
+    }
+
+    // extract into a private folder and move it into place in a single step,
+    // such that concurrent instances never observe an incomplete folder
+    QTemporaryDir tmpdir(this->root + QString("/extract-%1-XXXXXX").arg(QCoreApplication::applicationPid()));
+    if(!tmpdir.isValid()) {
+        throw std::runtime_error("Could not create staging folder in " + this->root.toStdString());
+    }
+    this->extract_assets(tmpdir.path());
+
+    if(QDir().rename(tmpdir.path(), this->asset_dir)) {
+        tmpdir.setAutoRemove(false);
+        qDebug() << "Staged assets in " << this->asset_dir;
+    } else if(!QFile::exists(this->get_script_path())) {
+        throw std::runtime_error("Could not stage assets in " + this->asset_dir.toStdString());
+    }
+}
+
+/**
+ * @brief Default staging location, preferring tmpfs
+ */
+QString StagingArea::default_location() {
+    QString user = qEnvironmentVariable("USER", qEnvironmentVariable("USERNAME"));
+    QString folder = QString(PROGRAM_NAME_LC) + "-" + (user.isEmpty() ? QString("staging") : user);
+
+    QFileInfo shm("/dev/shm");
+    if(shm.isDir() && shm.isWritable()) {
+        return shm.absoluteFilePath() + "/" + folder;
+    }
+
+    return QDir::tempPath() + "/" + folder;
+}
+
+/**
+ * @brief Create an empty folder for a job or a session
+ * @return path to the folder, to be removed by the caller
+ */
+QString StagingArea::create_job_dir() const {
+    QTemporaryDir dir(this->root + QString("/job-%1-XXXXXX").arg(QCoreApplication::applicationPid()));
+    if(!dir.isValid()) {
+        throw std::runtime_error("Could not create job folder in " + this->root.toStdString());
+    }
+    dir.setAutoRemove(false);
+
+    return QDir::cleanPath(dir.path());
+}
+
+/**
+ * @brief Make a file available under a second path without copying where possible
+ *
+ * Tries a hardlink and falls back to a copy. Symbolic links are not used, as
+ * the source may be replaced while the job is running.
+ */
+bool StagingArea::link_or_copy(const QString& source, const QString& dest) {
+    QFile::remove(dest);
+
+#ifdef Q_OS_UNIX
+    QByteArray source_path = QFile::encodeName(QFileInfo(source).absoluteFilePath());
+    QByteArray dest_path = QFile::encodeName(dest);
+    if(::link(source_path.constData(), dest_path.constData()) == 0) {
+        return true;
+    }
+#endif
+
+    // hardlinks do not cross file systems, e.g. from the data folder to tmpfs
+    return QFile::copy(source, dest);
+}
+
+/**
+ * @brief Copy Blender template, Python script and atoms.json to a folder
+ */
+void StagingArea::extract_assets(const QString& path) const {
+    for(const QString& asset : {":/assets/blender/axes_template.blend",
+                                ":/assets/blender/render_image.py",
+                                ":/assets/configuration/atoms.json"}) {
+        QString dest = path + "/" + QFileInfo(asset).fileName();
+        if(!QFile::copy(asset, dest)) {
+            throw std::runtime_error("Could not extract " + asset.toStdString() + " from assets.");
+        }
+
+        // files copied from the resource bundle are read-only already, make sure of it
+        QFile::setPermissions(dest, QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+    }
+}
+
+/**
+ * @brief Remove the job and extraction folders of processes that no longer run
+ *
+ * Folders are removed by their owner once they are no longer needed, but
+ * remain after a crash or kill; on tmpfs they take up memory until a reboot.
+ */
+void StagingArea::remove_stale_dirs() const {
+    QDir dir(this->root);
+    for(const QFileInfo& info : dir.entryInfoList({"job-*", "extract-*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if(is_stale(info) && QDir(info.absoluteFilePath()).removeRecursively()) {
+            qDebug() << "Removed stale staging folder " << info.fileName();
+        }
+    }
+}
+
+/**
+ * @brief Whether the owner of a job or extraction folder no longer runs
+ */
+bool StagingArea::is_stale(const QFileInfo& folder) {
+    // e.g. job-1234-AbCdEf, where 1234 is the process id of the owner
+    bool ok = false;
+    qint64 pid = folder.fileName().section('-', 1, 1).toLongLong(&ok);
+    if(ok && pid == QCoreApplication::applicationPid()) {
+        return false;
+    }
+
+#ifdef Q_OS_UNIX
+    return !ok || (::kill(pid, 0) != 0 && errno != EPERM);
+#else
+    // without a portable liveness check, only folders untouched for a week are stale
+    return folder.lastModified().addDays(7) < QDateTime::currentDateTime();
+#endif
+}
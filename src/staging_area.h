@@ -0,0 +1,107 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#ifndef STAGINGAREA_H
+#define STAGINGAREA_H
+
+#include <QString>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#endif
+
+#include "config.h"
+
+/**
+ * @brief Read-only copy of the Blender assets shared by all render jobs
+ *
+ * The Blender template, render_image.py and atoms.json are extracted from the
+ * resource bundle once into a folder named after their hash, such that all
+ * jobs, sessions and concurrent instances of the same version share a single
+ * copy. When available, the folder lives on tmpfs (/dev/shm). Job folders are
+ * created next to it and only hold the manifest and a link to the atompack.
+ * Their names hold the process id of their owner, such that the folders left
+ * behind by a crashed or killed instance are removed by the next one.
+ */
+class StagingArea {
+private:
+    QString root;           // holds the asset folders and the job folders
+    QString asset_dir;      // extracted assets of this version
+
+public:
+    /**
+     * @brief Extract the assets, unless another process already did so
+     * @param asset_hash    hash over the assets (see RenderCache::hash_assets)
+     * @param _root         folder to stage in; empty for the default location
+     */
+    StagingArea(const QByteArray& asset_hash, const QString& _root = QString());
+
+    /**
+     * @brief Default staging location, preferring tmpfs
+     */
+    static QString default_location();
+
+    inline QString get_template_path() const {
+        return this->asset_dir + "/axes_template.blend";
+    }
+
+    inline QString get_script_path() const {
+        return this->asset_dir + "/render_image.py";
+    }
+
+    /**
+     * @brief Create an empty folder for a job or a session
+     * @return path to the folder, to be removed by the caller
+     */
+    QString create_job_dir() const;
+
+    /**
+     * @brief Make a file available under a second path without copying where possible
+     *
+     * Tries a hardlink and falls back to a copy. Symbolic links are not used, as
+     * the source may be replaced while the job is running.
+     */
+    static bool link_or_copy(const QString& source, const QString& dest);
+
+private:
+    void extract_assets(const QString& path) const;
+
+    /**
+     * @brief Remove the job and extraction folders of processes that no longer run
+     */
+    void remove_stale_dirs() const;
+
+    /**
+     * @brief Whether the owner of a job or extraction folder no longer runs
+     */
+    static bool is_stale(const QFileInfo& folder);
+};
+
+#endif // STAGINGAREA_H
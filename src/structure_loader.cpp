@@ -30,7 +30,10 @@ std::vector<std::shared_ptr<Structure>> StructureLoader::load_file(const QString
     QFileInfo file_info(path);
     QString filename = file_info.fileName();
 
-    if(filename.contains("CONTCAR") || filename.contains("POSCAR")) {
+    if(filename.contains("OUTCAR")) {
+        qDebug() << "Recognising file as OUTCAR type: " << path;
+        return this->load_outcar(path.toStdString());
+    } else if(filename.contains("CONTCAR") || filename.contains("POSCAR")) {
         qDebug() << "Recognising file as POSCAR/CONTCAR type: " << path;
         return this->load_poscar(path.toStdString());
     } else if(filename == "logfile") {
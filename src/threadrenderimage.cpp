@@ -23,229 +23,1912 @@ ThreadRenderImage::ThreadRenderImage() {
 
 }
 
+/**
+ * @brief Default render parameters, identical to the defaults of the settings panel
+ */
+QMap<QString, QVariant> ThreadRenderImage::default_parameters() {
+    QMap<QString, QVariant> parameters;
+    parameters.insert("ortho_scale", QVariant("auto"));
+    parameters.insert("ortho_custom_scale", QVariant(10.0));
+    parameters.insert("camera_direction", QVariant("Z+"));
+    parameters.insert("show_unitcell", QVariant(false));
+    parameters.insert("expansion", QVariant(false));
+    parameters.insert("hide_axes", QVariant(true));
+    parameters.insert("resolution_x", QVariant(512));
+    parameters.insert("resolution_y", QVariant(512));
+    parameters.insert("tile_x", QVariant(256));
+    parameters.insert("tile_y", QVariant(256));
+    parameters.insert("samples", QVariant(128));
+    parameters.insert("nsubdiv", QVariant(4));
+    parameters.insert("lod_segment_pixels", QVariant(2.0));
+    parameters.insert("instancing", QVariant(false));
+    parameters.insert("atmat", QVariant("specular"));
+    parameters.insert("bondmat", QVariant("soft"));
+    parameters.insert("custom_json", QVariant(""));
+    parameters.insert("nr_workers", QVariant(1));
+    parameters.insert("session_mode", QVariant(false));
+    parameters.insert("use_cache", QVariant(false));
+    parameters.insert("cache_size_mb", QVariant(1024));
+    parameters.insert("resume", QVariant(false));
+    parameters.insert("queue_order", QVariant("file"));
+    parameters.insert("distributed", QVariant(false));
+    parameters.insert("lease_timeout", QVariant(300));
+    parameters.insert("job_time_budget", QVariant(0));
+    parameters.insert("queue_deadline", QVariant(0));
+    parameters.insert("views", QVariant(""));
+    parameters.insert("animation", QVariant(false));
+    parameters.insert("frame_step", QVariant(1));
+    parameters.insert("split_tiles", QVariant(1));
+    parameters.insert("draft_pass", QVariant(false));
+    parameters.insert("draft_scale", QVariant(0.25));
+    parameters.insert("draft_samples", QVariant(16));
+    parameters.insert("reject_file", QVariant(""));
+    parameters.insert("render_device", QVariant("auto"));
+    parameters.insert("threads_per_worker", QVariant(0));
+    parameters.insert("pin_workers", QVariant(true));
+    parameters.insert("adaptive_sampling", QVariant(false));
+    parameters.insert("noise_threshold", QVariant(0.01));
+    parameters.insert("denoise", QVariant(false));
+    parameters.insert("reference_samples", QVariant(512));
+    parameters.insert("output_format", QVariant("png"));
+    parameters.insert("output_quality", QVariant(-1));
+    parameters.insert("thumbnail_size", QVariant(0));
+    parameters.insert("output_threads", QVariant(2));
+    parameters.insert("atompack_version", QVariant(2));
+
+    return parameters;
+}
+
+/**
+ * @brief Location of the rendered image of a job
+ *
+ * Without an output folder the image is placed next to the structure file,
+ * otherwise the folder layout below the base folder is mirrored.
+ *
+ * @param name  name of the view or frame; empty for a single image
+ * @param draft whether to refer to the image of the draft pass
+ */
+QString ThreadRenderImage::get_image_path(int jobid, const QString& name, bool draft) const {
+    QString folder = QFileInfo(this->files[jobid]).absoluteDir().path();
+    if(this->output_folder.isEmpty()) {
+        return folder + "/" + get_image_filename(name, draft, this->get_image_extension());
+    }
+
+    QString relpath = QDir(this->base_folder).relativeFilePath(folder);
+    if(relpath.startsWith("..")) {
+        // structure lies outside the base folder, fall back to the job id
+        relpath = QString("job_%1").arg(jobid, 4, 10, QChar('0'));
+    }
+
+    return QDir::cleanPath(this->output_folder + "/" + relpath + "/" + get_image_filename(name, draft, this->get_image_extension()));
+}
+
+/**
+ * @brief Locations of all images of a job, one per view or animation frame
+ * @param draft whether to refer to the images of the draft pass
+ */
+QStringList ThreadRenderImage::get_image_paths(int jobid, bool draft) const {
+    QStringList paths;
+    for(const QString& name : this->get_output_names(jobid)) {
+        paths << this->get_image_path(jobid, name, draft);
+    }
+
+    return paths;
+}
+
+/**
+ * @brief Parse a list of views
+ *
+ * Views are given either as a list of objects holding a camera_direction
+ * and/or an object_euler (and optionally a name) or as a comma separated
+ * string in which every view reads "Z+", "30/0/90" or "X+:30/0/90".
+ *
+ * @return list of view objects, each with a name usable in a file name
+ */
+QJsonArray ThreadRenderImage::parse_views(const QVariant& views) {
+    QList<QJsonObject> specs;
+    if(views.type() == QVariant::List) {
+        for(const QVariant& view : views.toList()) {
+            if(view.type() == QVariant::Map) {
+                specs << QJsonObject::fromVariantMap(view.toMap());
+            } else {
+                for(const QJsonValue& spec : parse_views(view)) {
+                    specs << spec.toObject();
+                }
+            }
+        }
+    } else {
+        static const QRegularExpression regex_direction("^[XYZ][+-]$");
+        for(const QString& token : views.toString().split(',', Qt::SkipEmptyParts)) {
+            QJsonObject spec;
+            for(const QString& part : token.trimmed().split(':', Qt::SkipEmptyParts)) {
+                if(regex_direction.match(part.trimmed().toUpper()).hasMatch()) {
+                    spec["camera_direction"] = part.trimmed().toUpper();
+                } else if(part.count('/') == 2) {
+                    spec["object_euler"] = part.trimmed();
+                } else {
+                    throw std::runtime_error("Invalid view specification: " + token.toStdString());
+                }
+            }
+            specs << spec;
+        }
+    }
+
+    QJsonArray result;
+    for(QJsonObject spec : specs) {
+        if(!spec.contains("name")) {
+            QStringList name;
+            if(spec.contains("camera_direction")) {
+                name << spec["camera_direction"].toString();
+            }
+            if(spec.contains("object_euler")) {
+                name << spec["object_euler"].toString().replace('/', '_');
+            }
+            spec["name"] = name.join('_');
+        }
+
+        // the name ends up in a file name
+        static const QRegularExpression regex_invalid("[^A-Za-z0-9+_.-]");
+        spec["name"] = spec["name"].toString().replace(regex_invalid, "_");
+        if(spec["name"].toString().isEmpty()) {
+            throw std::runtime_error("View without camera direction or orientation.");
+        }
+        result.append(spec);
+    }
+
+    return result;
+}
+
 void ThreadRenderImage::run() {
-    qDebug() << "Running Blender for " << this->files.count() << " structures.";
-    for(int i=0; i<this->files.count(); i++) {
+    // every structure is rendered once per view
+    try {
+        this->views = parse_views(this->parameters.value("views"));
+    } catch (const std::exception& e) {
+        qCritical() << "Ignoring views: " << e.what();
+        this->views = QJsonArray();
+    }
+
+    // atom_colors and atom_radii are stored in the atompacks
+    this->atom_style = AtomStyle(this->parameters.value("custom_json").toString());
 
+    // collect the jobs to be rendered
+    this->queue_start = std::chrono::steady_clock::now();
+    this->pending.clear();
+    this->pending_tiles.clear();
+    this->tile_sets.clear();
+    this->cancelled = false;
+    this->drafting = false;
+    this->reject_file_modified = QDateTime();
+    {
+        QMutexLocker lock(&this->mutex_rejected);
+        this->rejected.clear();
+    }
+    this->job_samples.fill(0, this->files.count());
+    this->job_time_limits.clear();
+    for(int i=0; i<this->files.count(); i++) {
         if(this->single_job_id >= 0 && this->single_job_id != i) {
             continue;
         }
+        this->pending.push_back(i);
+    }
+
+    // predict the render time of every job to order the queue and estimate its duration
+    this->cost_model = std::make_unique<CostModel>();
+    this->job_features.clear();
+    for(int i : this->pending) {
+        this->job_features[i] = this->compute_features(this->files[i]);
+    }
+    this->order_queue();
+
+    // content-addressed store of earlier renders
+    this->cache.reset();
+    this->input_hashes.clear();
+    if(this->parameters.value("use_cache", false).toBool()) {
+        try {
+            qint64 cache_size = this->parameters.value("cache_size_mb", 1024).toLongLong() * 1024 * 1024;
+            this->cache = std::make_unique<RenderCache>(cache_size);
+        } catch (const std::exception& e) {
+            qCritical() << "Could not initialize render cache: " << e.what();
+        }
+    }
+
+    // images are published on separate threads while the workers continue
+    this->output_stage = std::make_unique<OutputStage>(this->cache.get(),
+                                                       this->parameters.value("output_format", "png").toString(),
+                                                       this->parameters.value("output_quality", -1).toInt(),
+                                                       this->parameters.value("thumbnail_size", 0).toInt(),
+                                                       this->parameters.value("output_threads", 2).toInt());
+
+    // jobs can be shared with other instances working on the same folder
+    this->distributed = this->parameters.value("distributed", false).toBool();
+    this->deferred.clear();
+    this->leases.reset();
+    this->claims.clear();
+
+    // journal of job states in the data folder; instances sharing the folder
+    // each keep their own journal
+    this->journal.reset();
+    if(!this->data_folder.isEmpty()) {
+        try {
+            QString journal_name = this->distributed ? QString("slabrender_journal_%1.jsonl").arg(QSysInfo::machineHostName())
+                                                     : QString(RenderJournal::FILENAME);
+            this->journal = std::make_unique<RenderJournal>(this->data_folder, journal_name);
+            for(int i : this->pending) {
+                this->journal->record(this->files[i], "queued");
+            }
+        } catch (const std::exception& e) {
+            qCritical() << "Could not open render journal: " << e.what();
+        }
+    }
+
+    // the assets are staged once per version; the cache and the journal
+    // identify a job by a hash over its inputs including the assets
+    this->asset_hash.clear();
+    this->staging.reset();
+    try {
+        this->asset_hash = RenderCache::hash_assets();
+        this->staging = std::make_unique<StagingArea>(this->asset_hash);
+    } catch (const std::exception& e) {
+        // without the assets no job can be rendered
+        QString error = QString("Could not stage Blender assets: %1").arg(e.what());
+        qCritical() << error;
+        for(int i : this->pending) {
+            if(this->journal) {
+                this->journal->record(this->files[i], "failed", {{"error", error}});
+            }
+            this->output[i] = QStringList{error};
+            emit(signal_job_failed(i));
+        }
+        this->pending.clear();
+        this->output_stage.reset();
+        emit(signal_queue_done());
+        return;
+    }
+
+    int max_tiles = std::max(1, this->parameters.value("split_tiles", 1).toInt());
+    int nr_workers = std::clamp(this->parameters.value("nr_workers", 1).toInt(), 1, std::max(1, (int)this->pending.size() * max_tiles));
+    qDebug() << "Running Blender for " << this->pending.size() << " structures using " << nr_workers << " worker(s).";
 
+    // the GUI thread can only request an interruption, poll for it
+    QTimer timer_interrupt;
+    connect(&timer_interrupt, &QTimer::timeout, &timer_interrupt, [this]() {
         if(isInterruptionRequested()) {
-            qDebug() << "Interruption received: cancelling queue.";
-            emit(signal_queue_cancelled());
+            this->cancel_workers();
+        }
+    });
+    timer_interrupt.start(100);
+
+    QTimer timer_lease;
+    if(this->distributed) {
+        int lease_timeout = std::max(10, this->parameters.value("lease_timeout", 300).toInt());
+        this->leases = std::make_unique<LeaseKeeper>(lease_timeout * 1000 / 4);
+        connect(this->leases.get(), &LeaseKeeper::signal_lease_lost, &timer_lease, [this](int jobid) {
+            this->abandon_job(jobid);
+        });
+        this->leases->start();
+        connect(&timer_lease, &QTimer::timeout, &timer_lease, [this]() {
+            this->retry_deferred();
+        });
+        timer_lease.start(lease_timeout * 1000 / 4);
+        qDebug() << "Sharing jobs with other instances as " << JobLease::instance_id();
+    }
+
+    // workers are constructed here such that they (and their processes) live in this thread
+    bool session_mode = this->parameters.value("session_mode", false).toBool();
+    this->assign_cpus(nr_workers);
+    for(int i=0; i<nr_workers; i++) {
+        RenderWorker* worker = new RenderWorker();
+        if(session_mode) {
+            worker->set_session_factory([this, i]() {
+                return this->build_session_process(i);
+            });
+        }
+        connect(worker, &RenderWorker::signal_job_finished, worker, [this, worker](int jobid, bool success) {
+            if(worker->get_part() >= 0) {
+                this->finalize_tile(worker, jobid, success);
+            } else {
+                this->finalize_job(worker, jobid, success);
+            }
+            this->dispatch(worker);
+            emit(signal_queue_eta(this->estimate_queue_time()));
+        });
+        connect(worker, &RenderWorker::signal_job_progress, worker, [this, worker](int jobid, double fraction, double eta) {
+            if(worker->get_part() >= 0) {
+                this->update_tile_progress(jobid, worker->get_part(), fraction, eta);
+            } else {
+                emit(signal_job_progress(jobid, fraction, eta));
+            }
+        });
+        this->workers.push_back(worker);
+    }
+
+    // a quick pass at low resolution and few samples precedes the final pass,
+    // such that jobs can be rejected before their final render has started
+    bool draft_pass = this->parameters.value("draft_pass", false).toBool();
+    if(draft_pass && this->distributed) {
+        qWarning() << "Draft pass is not available when sharing the queue with other hosts";
+        draft_pass = false;
+    }
+
+    // a single loop serves both passes, see quit_if_idle
+    QEventLoop loop;
+    this->event_loop = &loop;
+
+    QList<int> jobs = this->pending;
+    for(bool draft : draft_pass ? QVector<bool>{true, false} : QVector<bool>{false}) {
+        this->drafting = draft;
+        this->pending = jobs;
+        if(draft_pass) {
+            qDebug() << (draft ? "Rendering drafts" : "Rendering final images");
+        }
+
+        // workers can already be occupied by the tiles of a split job
+        for(RenderWorker* worker : this->workers) {
+            if(!worker->is_busy()) {
+                this->dispatch(worker);
+            }
+        }
+        emit(signal_queue_eta(this->estimate_queue_time()));
+
+        if(!this->is_exhausted()) {
+            loop.exec();
+        }
+
+        if(this->cancelled) {
             break;
         }
+    }
+    this->drafting = false;
+    this->event_loop = nullptr;
+
+    // images of the last jobs may still be in the works
+    this->output_stage->wait();
+    this->output_stage.reset();
+
+    timer_interrupt.stop();
+    timer_lease.stop();
+    if(this->leases) {
+        this->leases->stop();
+    }
+    qDeleteAll(this->workers);
+    this->workers.clear();
+    this->cost_model->save();
+
+    if(this->cancelled) {
+        qDebug() << "Interruption received: cancelling queue.";
+        emit(signal_queue_cancelled());
+    }
+
+    // emit all jobs are processed
+    emit(signal_queue_done());
+}
+
+/**
+ * @brief Launch the next pending job on a worker or stop the event loop
+ *        when the queue is exhausted and all workers are idle
+ */
+void ThreadRenderImage::dispatch(RenderWorker* worker) {
+    // tiles go first, such that a split job completes as early as possible
+    while(!this->cancelled && !this->pending_tiles.isEmpty()) {
+        auto tile = this->pending_tiles.takeFirst();
+        if(this->launch_tile(worker, tile.first, tile.second)) {
+            return;
+        }
+    }
 
+    while(!this->cancelled && !this->pending.isEmpty()) {
+        int i = this->pending.takeFirst();
         const QString& file = this->files[i];
         qDebug() << "Parsing: " << file;
-        this->create_atompack(file);
-        QProcess* process = this->build_process(file);
-
-        // emit job start
-        emit(signal_job_start(i));
-        auto start = std::chrono::steady_clock::now();
-
-        process->start();
-        qDebug() << "Blender process launched";
-        if(process->waitForStarted(1000)) {
-            qDebug() << "Blender process started";
-            if(process->waitForFinished(60 * 60 * 1000)) { // timeout at one hour
-                qDebug() << "Blender process finished";
-
-                // collect output of job
-                QStringList result;
-                auto lines = process->readAll().split('\n');
-                for(const QByteArray& line : lines) {
-                    result << line;
-                }
 
-                // read any errors
-                auto error_lines = process->readAllStandardError().split('\n');
-                for(const QByteArray& line : error_lines) {
-                    result << line;
+        // job folder holding the atompack and the manifest
+        QString cwd;
+
+        // rejected jobs are only rendered as a draft
+        if(!this->drafting) {
+            this->read_reject_file();
+            if(this->is_rejected(i)) {
+                qDebug() << "Skipping rejected job " << i;
+                if(this->journal) {
+                    this->journal->record(file, "rejected");
                 }
+                emit(signal_job_rejected(i));
+                continue;
+            }
+        }
 
-                // store output of job
-                this->output[i] = result;
+        try {
+            if(this->distributed) {
+                if(this->complete_if_done_elsewhere(i)) {
+                    continue;
+                }
 
-                // copy image back
-                QFile imagefile(process->workingDirectory() + "/image.png");
-                if(imagefile.open(QIODevice::ReadOnly)) {
-                    QString storepath = QFileInfo(file).absoluteDir().path() + "/image.png";
+                int lease_timeout = std::max(10, this->parameters.value("lease_timeout", 300).toInt());
+                // kept between attempts, as it measures how long the claim of another instance has not changed
+                std::shared_ptr<JobLease>& lease = this->claims[i];
+                if(!lease) {
+                    lease = std::make_shared<JobLease>(file, JobLease::instance_id(), lease_timeout);
+                }
+                if(!lease->acquire()) {
+                    qDebug() << "Job " << i << " is claimed by " << JobLease::get_owner(file);
+                    this->deferred.push_back(i);
+                    continue;
+                }
+                this->leases->insert(i, lease);
 
-                    // remove existing file if it exists
-                    if(QFile::exists(storepath)) {
-                        QFile::remove(storepath);
-                    }
-                    imagefile.copy(storepath);
+                // the previous owner may have completed the job just before releasing it
+                if(this->complete_if_done_elsewhere(i)) {
+                    this->release_lease(i, false);
+                    continue;
                 }
+            }
+
+            this->job_timings[i].clear();
+
+            // structures sharing a folder, and hosts sharing the folder, each
+            // write the atompack into a job folder of their own
+            auto start = std::chrono::steady_clock::now();
+            cwd = this->staging->create_job_dir();
+            this->add_timing(i, "staging", start);
+
+            this->job_frames[i] = this->create_atompack(file, cwd + "/atompack.bin", i);
+            if(!this->drafting) {
+                this->apply_time_budget(i);
+            }
+
+            if(!this->asset_hash.isEmpty()) {
+                this->input_hashes[i] = this->compute_input_hash(i, cwd + "/atompack.bin");
+            }
+
+            // skip jobs that were completed in a previous run with identical input
+            if(this->journal && !this->drafting && this->parameters.value("resume", false).toBool() &&
+               this->journal->is_done(file, this->input_hashes[i]) &&
+               this->has_images(i)) {
+                QDir(cwd).removeRecursively();
+                this->complete_without_render(i, "Skipped: completed in a previous run",
+                                              this->journal->get_done(file)["process_time"].toDouble());
+                this->release_lease(i, true);
+                continue;
+            }
+
+            // identical jobs do not need to be rendered again
+            if(this->cache && this->restore_from_cache(i)) {
+                QDir(cwd).removeRecursively();
+                this->release_lease(i, true);
+                continue;
+            }
 
-                // emit job done
-                auto end = std::chrono::steady_clock::now();
-                std::chrono::duration<double> elapsed_seconds = end-start;
-                this->process_times[i] = elapsed_seconds.count();
-                emit(signal_job_done(i));
+            // drafts are not recorded, the journal tracks the final images
+            if(this->journal && !this->drafting) {
+                this->journal->record(file, "running", {{"input_hash", this->input_hashes[i]},
+                                                        {"samples", this->job_samples[i]},
+                                                        {"time_limit", this->job_time_limits.value(i)}});
+            }
+
+            // large images are rendered in bands by the otherwise idle workers
+            int nr_tiles = this->get_nr_tiles(i);
+            if(nr_tiles > 1) {
+                emit(signal_job_start(i));
+                this->split_job(worker, i, nr_tiles, cwd);
+                return;
+            }
+
+            start = std::chrono::steady_clock::now();
+            this->build_manifest_file(cwd + "/manifest.json", i);
+            this->add_timing(i, "staging", start);
+            worker->set_timeout(this->get_timeout(i));
+
+            // emit job start
+            emit(signal_job_start(i));
+            if(worker->is_session()) {
+                worker->submit(i, cwd);
             } else {
-                qCritical() << "Process did not finish";
+                worker->launch(i, this->build_process(cwd, worker));
             }
-        } else {
-            qCritical() << "Process did not launch";
-            qCritical() << process->errorString();
+            return;
+        } catch (const std::exception& e) {
+            qCritical() << "Could not prepare job " << i << ": " << e.what();
+            if(!cwd.isEmpty()) {
+                QDir(cwd).removeRecursively();
+            }
+            if(this->journal && !this->drafting) {
+                this->journal->record(file, "failed", {{"error", e.what()}});
+            }
+            this->release_lease(i, false);
+            emit(signal_job_failed(i));
         }
+    }
+
+    this->quit_if_idle();
+}
+
+/**
+ * @brief Collect output of a finished job and copy its image back
+ */
+void ThreadRenderImage::finalize_job(RenderWorker* worker, int jobid, bool success) {
+    this->output[jobid] = worker->get_output();
+    for(auto it = worker->get_timings().begin(); it != worker->get_timings().end(); ++it) {
+        this->job_timings[jobid][it.key()] += it.value();
+    }
+    this->complete_job(jobid, success, worker->get_working_directory(), worker->get_process_time(), worker->get_samples());
+}
+
+/**
+ * @brief Publish the images of a finished job and record its outcome
+ * @param cwd           job folder holding the rendered images, removed afterwards
+ * @param process_time  render time in seconds
+ * @param samples       samples rendered according to Cycles, -1 when unknown
+ */
+void ThreadRenderImage::complete_job(int jobid, bool success, const QString& cwd, double process_time, int samples) {
+    const QString& file = this->files[jobid];
+
+    if(!success) {
+        qCritical() << "Render job " << jobid << " failed: " << file;
+        if(this->journal && !this->drafting) {
+            this->journal->record(file, "failed", {{"input_hash", this->input_hashes.value(jobid)},
+                                                   {"process_time", process_time}});
+        }
+        this->release_lease(jobid, false);
+        emit(signal_job_failed(jobid));
 
         // clean up folder
-        QDir dir(process->workingDirectory());
-        dir.removeRecursively();
+        if(!cwd.isEmpty()) {
+            QDir(cwd).removeRecursively();
+        }
+        return;
     }
 
-    // emit all jobs are processed
-    emit(signal_queue_done());
+    this->process_times[jobid] = process_time;
+
+    // Cycles stops at its time limit before all requested samples are rendered;
+    // the journal and the cost model receive the samples the image has
+    if(samples > 0 && !this->drafting) {
+        this->job_samples[jobid] = std::min(samples, this->get_samples(jobid));
+    }
+
+    if(this->job_features.contains(jobid)) {
+        JobFeatures features = this->job_features[jobid];
+        features.samples = this->get_samples(jobid);
+        if(this->drafting) {
+            double scale = this->parameters.value("draft_scale", 0.25).toDouble();
+            features.pixels *= scale * scale;
+            features.samples = std::min(features.samples, this->parameters.value("draft_samples", 16).toDouble());
+        }
+        if(samples > 0) {
+            features.samples = std::min(features.samples, (double)samples);
+        }
+        this->cost_model->add_sample(features, this->process_times[jobid]);
+    }
+
+    // the images are published in the background while the worker renders its next job
+    OutputTask task;
+    task.cleanup_dir = cwd;
+    for(const QString& name : this->get_output_names(jobid)) {
+        OutputImage image;
+        image.source = cwd + "/" + get_image_filename(name);
+        image.dest = this->get_image_path(jobid, name, this->drafting);
+        image.cache_key = this->input_hashes.contains(jobid) ? this->get_cache_key(jobid, name) : QString();
+        task.images.push_back(image);
+    }
+
+    bool draft = this->drafting;
+    this->output_stage->submit(task, [this, jobid, draft](const OutputResult& result) {
+        this->publish_done(jobid, draft, result);
+        this->quit_if_idle();
+    });
+}
+
+/**
+ * @brief Report a job whose images have been published by the output stage
+ * @param draft     whether the images belong to the draft pass
+ */
+void ThreadRenderImage::publish_done(int jobid, bool draft, const OutputResult& result) {
+    const QString& file = this->files[jobid];
+
+    if(!result.success) {
+        qCritical() << "Could not publish the images of job " << jobid << ": " << file;
+        if(this->journal && !draft) {
+            this->journal->record(file, "failed", {{"input_hash", this->input_hashes.value(jobid)},
+                                                   {"error", "could not store image"}});
+        }
+        this->release_lease(jobid, false);
+        emit(signal_job_failed(jobid));
+        return;
+    }
+
+    this->job_timings[jobid]["output"] += result.process_time;
+    if(draft) {
+        emit(signal_draft_done(jobid));
+        return;
+    }
+
+    QJsonObject noise_reduction = this->get_noise_reduction(jobid);
+    if(noise_reduction.contains("reference_time")) {
+        this->output[jobid].append(QString("Predicted render time at %1 samples without noise reduction: %2 s")
+                                   .arg(noise_reduction["reference_samples"].toInt())
+                                   .arg(noise_reduction["reference_time"].toDouble(), 0, 'f', 1));
+    }
+    if(this->journal) {
+        QJsonObject record = {{"input_hash", this->input_hashes.value(jobid)},
+                              {"output_hash", QString(result.output_hash.toHex())},
+                              {"samples", this->job_samples[jobid]},
+                              {"frames", this->job_frames[jobid]},
+                              {"process_time", this->process_times[jobid]}};
+        record["timings"] = this->get_timings_json(jobid);
+        for(auto it = noise_reduction.begin(); it != noise_reduction.end(); ++it) {
+            record.insert(it.key(), it.value());
+        }
+        this->journal->record(file, "done", record);
+    }
+    this->release_lease(jobid, true);
+    emit(signal_job_done(jobid, this->get_samples(jobid), this->get_nr_frames(jobid)));
+}
+
+/**
+ * @brief Key of an image in the render cache
+ *
+ * Images are cached in the format they are published in; the cache keeps
+ * entries of different formats apart by their extension.
+ */
+QString ThreadRenderImage::get_cache_key(int jobid, const QString& name) const {
+    return this->input_hashes.value(jobid) + (name.isEmpty() ? QString() : "-" + name);
+}
+
+/**
+ * @brief Hash over the Blender assets, the atompack and the requested settings of a job
+ *
+ * The number of samples chosen to fit a time budget depends on the history of
+ * the cost model and would give identical jobs a different hash in every run.
+ * The hash therefore covers the requested samples and the budget instead, such
+ * that a job rendered under a budget is restored from the cache (or skipped on
+ * resume) with the samples it was rendered with in the earlier run.
+ */
+QString ThreadRenderImage::compute_input_hash(int jobid, const QString& atompackpath) {
+    QFile atompackfile(atompackpath);
+    if(!atompackfile.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open " + atompackfile.fileName().toStdString());
+    }
+
+    QByteArray settings = this->build_manifest();
+    settings += QString("job_time_budget: %1, queue_deadline: %2").arg(this->parameters.value("job_time_budget", 0).toDouble())
+                                                                  .arg(this->parameters.value("queue_deadline", 0).toDouble()).toUtf8();
+
+    return RenderCache::get_key(this->asset_hash, atompackfile.readAll(), settings);
+}
+
+/**
+ * @brief Restore the image of a job from the render cache
+ * @return whether the job was found in the cache
+ */
+bool ThreadRenderImage::restore_from_cache(int jobid) {
+    auto start = std::chrono::steady_clock::now();
+    const QString& key = this->input_hashes[jobid];
+    const QString& file = this->files[jobid];
+
+    // a job is only restored when the images of all views or frames are present
+    for(const QString& name : this->get_output_names(jobid)) {
+        QString storepath = this->get_image_path(jobid, name, this->drafting);
+        QDir().mkpath(QFileInfo(storepath).absolutePath());
+        if(!this->cache->fetch(this->get_cache_key(jobid, name), storepath)) {
+            return false;
+        }
+    }
+
+    // only the thumbnails are left to the output stage
+    if(this->parameters.value("thumbnail_size", 0).toInt() > 0) {
+        OutputTask task;
+        for(const QString& name : this->get_output_names(jobid)) {
+            task.images.push_back({QString(), this->get_image_path(jobid, name, this->drafting), QString()});
+        }
+        this->output_stage->submit(task, [this](const OutputResult&) {
+            this->quit_if_idle();
+        });
+    }
+
+    qDebug() << "Restored job " << jobid << " from render cache";
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+    if(this->drafting) {
+        this->output[jobid] = QStringList{"Draft restored from render cache: " + key};
+        this->process_times[jobid] = elapsed_seconds.count();
+        emit(signal_draft_done(jobid));
+        return true;
+    }
+    if(this->journal) {
+        this->journal->record(file, "done", {{"input_hash", key},
+                                             {"process_time", elapsed_seconds.count()},
+                                             {"cached", true}});
+    }
+    this->complete_without_render(jobid, "Image restored from render cache: " + key, elapsed_seconds.count());
+
+    return true;
+}
+
+/**
+ * @brief Report a job whose image is available without rendering
+ */
+void ThreadRenderImage::complete_without_render(int jobid, const QString& message, double process_time) {
+    emit(signal_job_start(jobid));
+    this->output[jobid] = QStringList{message};
+    this->process_times[jobid] = process_time;
+    emit(signal_job_done(jobid, this->get_samples(jobid), this->get_nr_frames(jobid)));
+}
+
+/**
+ * @brief Kill all live Blender processes and drop the pending jobs
+ */
+void ThreadRenderImage::cancel_workers() {
+    if(this->cancelled) {
+        return;
+    }
+
+    this->cancelled = true;
+    this->pending.clear();
+    this->pending_tiles.clear();
+    this->deferred.clear();
+    for(RenderWorker* worker : this->workers) {
+        if(worker->is_busy()) {
+            if(this->journal) {
+                this->journal->record(this->files[worker->get_jobid()], "failed", {{"error", "cancelled"}});
+            }
+            this->release_lease(worker->get_jobid(), false);
+            QString cwd = worker->get_working_directory();
+            worker->kill();
+            QDir(cwd).removeRecursively();
+        }
+    }
+
+    // folders of tiles that finished before the cancellation
+    for(const TileSet& tiles : this->tile_sets) {
+        for(const QString& dir : tiles.dirs) {
+            if(!dir.isEmpty()) {
+                QDir(dir).removeRecursively();
+            }
+        }
+        QDir(tiles.source_dir).removeRecursively();
+    }
+    this->tile_sets.clear();
+
+    if(this->event_loop) {
+        this->event_loop->quit();
+    }
+}
+
+/**
+ * @brief Determine the properties of a job that drive its render time
+ */
+JobFeatures ThreadRenderImage::compute_features(const QString& file) {
+    JobFeatures features;
+    features.pixels = this->parameters.value("resolution_x", 512).toDouble() * this->parameters.value("resolution_y", 512).toDouble();
+    features.samples = this->parameters.value("samples", 128).toDouble();
+
+    // every view is a separate render of the same scene
+    features.pixels *= std::max(1, (int)this->views.size());
+
+    try {
+        auto structures = sl.load_file(file);
+        QVector<int> frames = this->get_frame_indices(structures.size());
+        auto structure = frames.isEmpty() ? structures.back() : structures.front();
+
+        // every frame of an animation is a separate render of the same scene
+        features.pixels *= std::max(1, (int)frames.size());
+
+        structure->update();
+        features.nr_atoms = structure->get_nr_atoms();
+        features.nr_bonds = structure->get_bonds().size();
+        if(this->parameters.value("expansion", false).toBool()) {
+            features.nr_atoms += structure->get_expansion_atoms().size();
+            features.nr_bonds += structure->get_expansion_bonds().size();
+        }
+    } catch (const std::exception& e) {
+        // the job itself reports the problem once it is dispatched
+        qWarning() << "Could not determine render cost of " << file << ": " << e.what();
+    }
+
+    return features;
+}
+
+/**
+ * @brief Sort the pending jobs according to the queue_order parameter
+ *
+ * Longest first packs the worker pool best and thereby minimizes the total
+ * duration of the queue; shortest first yields finished images early.
+ */
+void ThreadRenderImage::order_queue() {
+    QString order = this->parameters.value("queue_order", "file").toString();
+
+    QHash<int, double> cost;
+    for(int i : this->pending) {
+        cost[i] = this->cost_model->predict(this->job_features[i]);
+    }
+
+    if(order == "longest") {
+        std::stable_sort(this->pending.begin(), this->pending.end(), [&cost](int a, int b) {
+            return cost[a] > cost[b];
+        });
+    } else if(order == "shortest") {
+        std::stable_sort(this->pending.begin(), this->pending.end(), [&cost](int a, int b) {
+            return cost[a] < cost[b];
+        });
+    }
+}
+
+/**
+ * @brief Estimate the remaining time of the queue by simulating the worker pool
+ *
+ * Every pending job is assigned, in queue order, to the worker that becomes
+ * available first, i.e. the same policy as dispatch().
+ */
+double ThreadRenderImage::estimate_queue_time() const {
+    std::vector<double> available;
+    for(const RenderWorker* worker : this->workers) {
+        if(worker->is_busy()) {
+            double predicted = this->cost_model->predict(this->job_features.value(worker->get_jobid()));
+            available.push_back(std::max(0.0, predicted - worker->get_elapsed_time()));
+        } else {
+            available.push_back(0.0);
+        }
+    }
+
+    if(available.empty()) {
+        return 0.0;
+    }
+
+    for(int i : this->pending) {
+        auto worker = std::min_element(available.begin(), available.end());
+        *worker += this->cost_model->predict(this->job_features.value(i));
+    }
+
+    return *std::max_element(available.begin(), available.end());
+}
+
+/**
+ * @brief Hash identifying a job across instances: assets, settings and structure file
+ */
+QString ThreadRenderImage::get_job_key(int jobid) {
+    QFile structurefile(this->files[jobid]);
+    if(!structurefile.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Could not open " + structurefile.fileName().toStdString());
+    }
+
+    return RenderCache::get_key(this->asset_hash, structurefile.readAll(), this->build_manifest());
 }
 
-QProcess* ThreadRenderImage::build_process(const QString& contcarfile) {
-    QString cwd = this->copy_template_files(contcarfile);
-    QStringList arguments = {"-b", "axes_template.blend", "-P", "render_image.py", "--", "manifest.json", "atompack.bin", cwd + "/image.png"};
-    QProcess* blender_process = new QProcess();
+/**
+ * @brief Report a job that another instance has completed
+ * @return whether the job is completed
+ */
+bool ThreadRenderImage::complete_if_done_elsewhere(int jobid) {
+    const QString& file = this->files[jobid];
+    QJsonObject done = JobLease::read_done(file);
+    if(done.isEmpty() || done["key"].toString() != this->get_job_key(jobid)) {
+        return false;
+    }
+
+    // the number of frames is only known once the atompack has been written
+    this->job_frames[jobid] = done["frames"].toInt();
+    if(!this->has_images(jobid)) {
+        return false;
+    }
+
+    // the input hash allows a resumed queue to skip the job as well
+    if(done.contains("input_hash")) {
+        this->input_hashes[jobid] = done["input_hash"].toString();
+    }
+    if(this->journal) {
+        this->journal->record(file, "done", {{"input_hash", done["input_hash"]},
+                                             {"rendered_by", done["owner"]},
+                                             {"process_time", done["process_time"]}});
+    }
+    this->complete_without_render(jobid, "Rendered by " + done["owner"].toString(), done["process_time"].toDouble());
+
+    return true;
+}
+
+/**
+ * @brief Give up the claim on a job
+ * @param done  whether to mark the job as completed for the other instances
+ */
+void ThreadRenderImage::release_lease(int jobid, bool done) {
+    auto lease = this->leases ? this->leases->take(jobid) : nullptr;
+    if(!lease) {
+        return;
+    }
+
+    if(done) {
+        try {
+            JobLease::mark_done(this->files[jobid],
+                                {{"key", this->get_job_key(jobid)},
+                                 {"input_hash", this->input_hashes.value(jobid)},
+                                 {"frames", this->job_frames[jobid]},
+                                 {"process_time", this->process_times[jobid]}});
+        } catch (const std::exception& e) {
+            qWarning() << "Could not mark job " << jobid << " as completed: " << e.what();
+        }
+    }
+
+    lease->release();
+}
+
+/**
+ * @brief Stop rendering a job whose lease has been reclaimed by another instance
+ *
+ * The other instance renders the job; it is deferred such that its images
+ * are picked up once the other instance marks it as completed. A job whose
+ * images are already being published is left to complete.
+ */
+void ThreadRenderImage::abandon_job(int jobid) {
+    const QString& file = this->files[jobid];
+
+    bool rendering = false;
+    for(RenderWorker* worker : this->workers) {
+        if(worker->is_busy() && worker->get_jobid() == jobid) {
+            QString cwd = worker->get_working_directory();
+            worker->kill();
+            QDir(cwd).removeRecursively();
+            rendering = true;
+        }
+    }
+
+    auto it = this->tile_sets.find(jobid);
+    if(it != this->tile_sets.end()) {
+        for(int i=this->pending_tiles.size()-1; i>=0; i--) {
+            if(this->pending_tiles[i].first == jobid) {
+                this->pending_tiles.removeAt(i);
+            }
+        }
+        for(const QString& dir : it->dirs) {
+            if(!dir.isEmpty()) {
+                QDir(dir).removeRecursively();
+            }
+        }
+        QDir(it->source_dir).removeRecursively();
+        this->tile_sets.erase(it);
+        rendering = true;
+    }
+
+    if(!rendering) {
+        return;
+    }
+
+    QString owner = JobLease::get_owner(file);
+    qWarning() << "Lost the lease on job " << jobid << " to " << owner << ", stopped rendering it";
+    if(this->journal) {
+        this->journal->record(file, "lost", {{"owner", owner}});
+    }
+    this->deferred.push_back(jobid);
+
+    for(RenderWorker* worker : this->workers) {
+        if(!worker->is_busy()) {
+            this->dispatch(worker);
+        }
+    }
+}
+
+/**
+ * @brief Retry the jobs claimed by other instances
+ *
+ * Jobs of instances that stopped sending heartbeats are picked up once their
+ * lease expires.
+ */
+void ThreadRenderImage::retry_deferred() {
+    if(this->cancelled || this->deferred.isEmpty()) {
+        return;
+    }
+
+    this->pending += this->deferred;
+    this->deferred.clear();
+    for(RenderWorker* worker : this->workers) {
+        if(!worker->is_busy()) {
+            this->dispatch(worker);
+        }
+    }
+    emit(signal_queue_eta(this->estimate_queue_time()));
+}
+
+/**
+ * @brief Choose the number of samples of a job such that it finishes within its time budget
+ *
+ * The budget is the smaller of the per-job budget and, with a queue deadline, a
+ * share of the remaining time proportional to the predicted cost of the job.
+ * When the cost model predicts that the configured samples do not fit, the
+ * number of samples is scaled down accordingly. As a safeguard against a poor
+ * prediction, Cycles is also given the remaining budget as its time limit.
+ */
+void ThreadRenderImage::apply_time_budget(int jobid) {
+    int samples = this->parameters.value("samples", 128).toInt();
+    this->job_samples[jobid] = samples;
+    this->job_time_limits.remove(jobid);
+
+    double budget = this->parameters.value("job_time_budget", 0).toDouble();
+    double deadline = this->parameters.value("queue_deadline", 0).toDouble();
+    if(budget <= 0.0 && deadline <= 0.0) {
+        return;
+    }
+
+    const JobFeatures& features = this->job_features.value(jobid);
+    double cost = this->cost_model->predict(features);
+
+    if(deadline > 0.0) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - this->queue_start;
+        double cost_remaining = cost;
+        for(int i : this->pending) {
+            cost_remaining += this->cost_model->predict(this->job_features.value(i));
+        }
+        double share = std::max(0.0, deadline - elapsed.count()) * std::max(1, (int)this->workers.size()) * cost / cost_remaining;
+        budget = budget > 0.0 ? std::min(budget, share) : share;
+    }
+
+    // time spent on launching Blender and building the scene does not depend on the samples
+    JobFeatures features_setup = features;
+    features_setup.samples = 0.0;
+    double setup = std::min(this->cost_model->predict(features_setup), cost);
+
+    if(cost > budget && cost > setup) {
+        int min_samples = std::min(16, samples);
+        double fraction = std::max(0.0, budget - setup) / (cost - setup);
+        samples = std::clamp((int)(samples * fraction), min_samples, samples);
+        qDebug() << "Reducing samples of job " << jobid << " to " << samples << " to fit a budget of " << budget << " seconds";
+    }
+
+    this->job_samples[jobid] = samples;
+    this->job_time_limits[jobid] = std::max(1.0, budget - setup);
+}
+
+/**
+ * @brief Names of the images produced per job; a single empty name without views
+ */
+QStringList ThreadRenderImage::get_view_names() const {
+    if(this->views.isEmpty()) {
+        return QStringList{QString()};
+    }
+
+    QStringList names;
+    for(const QJsonValue& view : this->views) {
+        names << view.toObject()["name"].toString();
+    }
+
+    return names;
+}
+
+/**
+ * @brief Names of the images produced by a job, i.e. its views or animation frames
+ */
+QStringList ThreadRenderImage::get_output_names(int jobid) const {
+    if(this->job_frames[jobid] == 0) {
+        return this->get_view_names();
+    }
+
+    QStringList names;
+    for(int i=0; i<this->job_frames[jobid]; i++) {
+        names << QString("%1").arg(i, 4, 10, QChar('0'));
+    }
+
+    return names;
+}
+
+/**
+ * @brief Indices of the structures in a trajectory that are rendered as animation frames
+ *
+ * Only with the animation parameter set; every frame_step-th structure is used
+ * and the final structure is always included. Single structures yield no
+ * frames and are rendered as a still.
+ */
+QVector<int> ThreadRenderImage::get_frame_indices(size_t nr_structures) const {
+    QVector<int> indices;
+    if(nr_structures < 2 || !this->parameters.value("animation", false).toBool()) {
+        return indices;
+    }
+
+    int step = std::max(1, this->parameters.value("frame_step", 1).toInt());
+    for(int i=0; i<(int)nr_structures; i+=step) {
+        indices.push_back(i);
+    }
+    if(indices.back() != (int)nr_structures - 1) {
+        indices.push_back(nr_structures - 1);
+    }
+
+    return indices;
+}
+
+QString ThreadRenderImage::get_image_filename(const QString& view, bool draft, const QString& extension) {
+    QString prefix = draft ? "draft" : "image";
+    return (view.isEmpty() ? prefix : prefix + "_" + view) + "." + extension;
+}
+
+/**
+ * @brief Extension of the published images, see the output_format parameter
+ */
+QString ThreadRenderImage::get_image_extension() const {
+    return OutputStage::get_extension(this->parameters.value("output_format", "png").toString());
+}
+
+/**
+ * @brief Exclude a job from the final pass; can be called from any thread
+ */
+void ThreadRenderImage::reject(int jobid) {
+    QMutexLocker lock(&this->mutex_rejected);
+    this->rejected.insert(jobid);
+}
+
+/**
+ * @brief Whether a job is excluded from the final pass
+ */
+bool ThreadRenderImage::is_rejected(int jobid) const {
+    QMutexLocker lock(&this->mutex_rejected);
+    return this->rejected.contains(jobid);
+}
+
+/**
+ * @brief Mark the jobs listed in the reject file as rejected
+ *
+ * Every line of the file holds the path to a structure file or its folder.
+ * The file is only read again when it has been modified.
+ */
+void ThreadRenderImage::read_reject_file() {
+    QFileInfo fileinfo(this->parameters.value("reject_file").toString());
+    if(fileinfo.filePath().isEmpty() || !fileinfo.exists() || fileinfo.lastModified() == this->reject_file_modified) {
+        return;
+    }
+    this->reject_file_modified = fileinfo.lastModified();
+
+    QFile file(fileinfo.absoluteFilePath());
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Could not read reject file " << fileinfo.absoluteFilePath();
+        return;
+    }
+
+    QSet<QString> paths;
+    while(!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if(!line.isEmpty()) {
+            paths.insert(QDir::cleanPath(QFileInfo(line).absoluteFilePath()));
+        }
+    }
+
+    for(int i=0; i<this->files.count(); i++) {
+        QFileInfo structure(this->files[i]);
+        if(paths.contains(QDir::cleanPath(structure.absoluteFilePath())) ||
+           paths.contains(QDir::cleanPath(structure.absolutePath()))) {
+            this->reject(i);
+        }
+    }
+}
+
+/**
+ * @brief Whether all images of a job are present
+ */
+bool ThreadRenderImage::has_images(int jobid) const {
+    for(const QString& path : this->get_image_paths(jobid)) {
+        if(!QFile::exists(path)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Maximum duration of a job in seconds before its worker is stopped
+ */
+int ThreadRenderImage::get_timeout(int jobid) const {
+    // budgeted jobs are aborted well before the regular timeout of one hour
+    return this->job_time_limits.contains(jobid) ? std::max(300, (int)(3.0 * this->job_time_limits[jobid])) : 60 * 60;
+}
+
+/**
+ * @brief Number of bands the image of a job is split into
+ *
+ * Still images are split according to the split_tiles parameter, but only
+ * when fewer jobs are pending than there are workers; otherwise the workers
+ * are kept busy by the queue itself and splitting only adds overhead.
+ */
+int ThreadRenderImage::get_nr_tiles(int jobid) const {
+    int nr_tiles = this->parameters.value("split_tiles", 1).toInt();
+    if(nr_tiles < 2 || this->drafting || this->job_frames[jobid] > 0 || !this->views.isEmpty() ||
+       this->pending.size() >= this->workers.size()) {
+        return 1;
+    }
+
+    // bands should remain considerably taller than their overlap
+    int height = this->parameters.value("resolution_y", 512).toInt();
+    return std::clamp(nr_tiles, 1, std::max(1, height / (4 * TILE_OVERLAP)));
+}
+
+/**
+ * @brief First and last (exclusive) row of a band, counted from the top
+ * @param overlap   number of rows to extend the band with on both sides
+ */
+QPair<int, int> ThreadRenderImage::get_band(int height, int nr_tiles, int tile, int overlap) {
+    int first = (int)((qint64)tile * height / nr_tiles);
+    int last = (int)((qint64)(tile + 1) * height / nr_tiles);
+
+    return qMakePair(std::max(0, first - overlap), std::min(height, last + overlap));
+}
+
+/**
+ * @brief Queue the tiles of a job and hand them to the idle workers
+ */
+void ThreadRenderImage::split_job(RenderWorker* worker, int jobid, int nr_tiles, const QString& source_dir) {
+    qDebug() << "Splitting job " << jobid << " into " << nr_tiles << " bands";
+
+    TileSet tiles;
+    tiles.source_dir = source_dir;
+    tiles.nr_tiles = nr_tiles;
+    tiles.remaining = nr_tiles;
+    for(int t=0; t<nr_tiles; t++) {
+        tiles.dirs << QString();
+        tiles.progress << 0.0;
+        tiles.eta << 0.0;
+    }
+    this->tile_sets[jobid] = tiles;
+    this->output[jobid].clear();
+
+    for(int t=nr_tiles-1; t>=0; t--) {
+        this->pending_tiles.push_front(qMakePair(jobid, t));
+    }
+
+    this->dispatch(worker);
+    for(RenderWorker* other : this->workers) {
+        if(!other->is_busy() && !this->pending_tiles.isEmpty()) {
+            this->dispatch(other);
+        }
+    }
+}
+
+/**
+ * @brief Render a tile of a split job on a worker
+ * @return whether the tile has been launched
+ */
+bool ThreadRenderImage::launch_tile(RenderWorker* worker, int jobid, int tile) {
+    TileSet& tiles = this->tile_sets[jobid];
+    try {
+        QString cwd = this->prepare_job_dir(tiles.source_dir + "/atompack.bin", jobid, tile);
+        tiles.dirs[tile] = cwd;
+        worker->set_timeout(this->get_timeout(jobid));
+
+        qDebug() << "Rendering band " << (tile + 1) << "/" << tiles.nr_tiles << " of job " << jobid;
+        if(worker->is_session()) {
+            worker->submit(jobid, cwd, tile);
+        } else {
+            worker->launch(jobid, this->build_process(cwd, worker), tile);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        qCritical() << "Could not prepare band " << tile << " of job " << jobid << ": " << e.what();
+        this->complete_tile(jobid, tile, false, 0.0);
+        return false;
+    }
+}
+
+/**
+ * @brief Collect output of a finished tile
+ */
+void ThreadRenderImage::finalize_tile(RenderWorker* worker, int jobid, bool success) {
+    int tile = worker->get_part();
+    this->output[jobid] << QString("=== Band %1/%2 ===").arg(tile + 1).arg(this->tile_sets[jobid].nr_tiles);
+    this->output[jobid] += worker->get_output();
+    for(auto it = worker->get_timings().begin(); it != worker->get_timings().end(); ++it) {
+        this->job_timings[jobid][it.key()] += it.value();
+    }
+    this->complete_tile(jobid, tile, success, worker->get_process_time(), worker->get_samples());
+}
+
+/**
+ * @brief Register a finished tile and complete the job once all tiles are in
+ */
+void ThreadRenderImage::complete_tile(int jobid, int tile, bool success, double process_time, int samples) {
+    TileSet& tiles = this->tile_sets[jobid];
+    tiles.process_time += process_time;
+    if(samples >= 0) {
+        tiles.samples = tiles.samples < 0 ? samples : std::min(tiles.samples, samples);
+    }
+    tiles.progress[tile] = 1.0;
+    tiles.eta[tile] = 0.0;
+    tiles.remaining--;
+
+    // the job fails as a whole, there is no use in rendering its other bands
+    if(!success && !tiles.failed) {
+        qCritical() << "Band " << tile << " of job " << jobid << " failed";
+        tiles.failed = true;
+        for(int i=this->pending_tiles.size()-1; i>=0; i--) {
+            if(this->pending_tiles[i].first == jobid) {
+                this->pending_tiles.removeAt(i);
+                tiles.remaining--;
+            }
+        }
+    }
+
+    if(tiles.remaining > 0) {
+        return;
+    }
+
+    // the image is assembled in the folder of the first band
+    bool stitched = !tiles.failed && this->stitch_tiles(jobid);
+    for(int t=1; t<tiles.nr_tiles; t++) {
+        if(!tiles.dirs[t].isEmpty()) {
+            QDir(tiles.dirs[t]).removeRecursively();
+        }
+    }
+    QDir(tiles.source_dir).removeRecursively();
+    QString cwd = tiles.dirs[0];
+    double total_time = tiles.process_time;
+    int samples = tiles.samples;
+    this->tile_sets.remove(jobid);
+
+    this->complete_job(jobid, stitched, cwd, total_time, samples);
+}
+
+/**
+ * @brief Assemble the bands of a split job into the image of the first tile
+ * @return whether all bands are present and the image has been written
+ */
+bool ThreadRenderImage::stitch_tiles(int jobid) {
+    const TileSet& tiles = this->tile_sets[jobid];
+    int width = this->parameters.value("resolution_x", 512).toInt();
+    int height = this->parameters.value("resolution_y", 512).toInt();
+
+    QVector<QImage> bands;
+    for(int t=0; t<tiles.nr_tiles; t++) {
+        bands.push_back(QImage(tiles.dirs[t] + "/image.png"));
+    }
+
+    QImage image = stitch_bands(bands, width, height, TILE_OVERLAP);
+    if(image.isNull()) {
+        qCritical() << "Could not stitch the bands of job " << jobid;
+        return false;
+    }
+
+    if(!image.save(tiles.dirs[0] + "/image.png", "PNG")) {
+        qCritical() << "Could not store stitched image of job " << jobid;
+        return false;
+    }
+    qDebug() << "Stitched " << tiles.nr_tiles << " bands of job " << jobid;
+
+    return true;
+}
+
+/**
+ * @brief Assemble bands rendered with an overlap into a single image
+ * @param bands     bands from top to bottom, each including its overlap (see get_band)
+ * @return the image, null when a band is missing or has an unexpected size
+ */
+QImage ThreadRenderImage::stitch_bands(const QVector<QImage>& bands, int width, int height, int overlap) {
+    QImage image;
+    for(int t=0; t<bands.size(); t++) {
+        auto rows = get_band(height, bands.size(), t);
+        auto rendered = get_band(height, bands.size(), t, overlap);
+        if(bands[t].isNull() || bands[t].width() != width || bands[t].height() != rendered.second - rendered.first) {
+            qCritical() << "Band " << t << " is missing or has an unexpected size";
+            return QImage();
+        }
+
+        if(image.isNull()) {
+            image = QImage(width, height, bands[t].format());
+        }
+        QImage band = bands[t].convertToFormat(image.format());
+
+        // the overlap only serves to give the pixels near the seam the same
+        // neighbourhood as in a full render (e.g. for denoising) and is dropped
+        for(int y=rows.first; y<rows.second; y++) {
+            memcpy(image.scanLine(y), band.constScanLine(y - rendered.first),
+                   std::min(image.bytesPerLine(), band.bytesPerLine()));
+        }
+    }
+
+    return image;
+}
+
+/**
+ * @brief Report the combined progress of the tiles of a split job
+ */
+void ThreadRenderImage::update_tile_progress(int jobid, int tile, double fraction, double eta) {
+    auto it = this->tile_sets.find(jobid);
+    if(it == this->tile_sets.end()) {
+        return;
+    }
+
+    it->progress[tile] = fraction;
+    it->eta[tile] = eta;
+    double total = std::accumulate(it->progress.begin(), it->progress.end(), 0.0) / it->nr_tiles;
+    emit(signal_job_progress(jobid, total, *std::max_element(it->eta.begin(), it->eta.end())));
+}
+
+/**
+ * @brief Whether no worker is rendering, no job is deferred and all images are published
+ */
+bool ThreadRenderImage::is_idle() const {
+    return !this->has_busy_workers() && this->deferred.isEmpty() &&
+           !(this->output_stage && this->output_stage->is_busy());
+}
+
+/**
+ * @brief Whether no job is pending and the queue is idle
+ */
+bool ThreadRenderImage::is_exhausted() const {
+    return this->pending.isEmpty() && this->pending_tiles.isEmpty() && this->is_idle();
+}
+
+/**
+ * @brief Stop the event loop once the queue is exhausted
+ *
+ * The queue can run dry before the loop of a pass has started, e.g. when
+ * all drafts are restored from the cache. The quit is therefore deferred
+ * until the loop processes its events, and only takes effect when the queue
+ * is still exhausted by then; a quit outside of the loop would otherwise
+ * end the next pass at once.
+ */
+void ThreadRenderImage::quit_if_idle() {
+    if(!this->event_loop || !this->is_exhausted()) {
+        return;
+    }
+
+    QEventLoop* loop = this->event_loop;
+    QMetaObject::invokeMethod(loop, [this, loop]() {
+        if(this->is_exhausted()) {
+            loop->quit();
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool ThreadRenderImage::has_busy_workers() const {
+    return std::any_of(this->workers.begin(), this->workers.end(), [](const RenderWorker* worker) {
+        return worker->is_busy();
+    });
+}
+
+/**
+ * @brief Divide the CPU threads over the workers and pin them to disjoint cores
+ *
+ * Without an explicit number of threads per worker, the cores available to
+ * this process are divided evenly over the workers.
+ */
+void ThreadRenderImage::assign_cpus(int nr_workers) {
+    int threads = std::max(0, this->parameters.value("threads_per_worker", 0).toInt());
+
+    this->worker_cpus = QVector<QVector<int>>(nr_workers);
+    if(this->parameters.value("pin_workers", true).toBool()) {
+        this->worker_cpus = CpuAffinity::partition(nr_workers, threads);
+    }
+
+    if(threads == 0) {
+        threads = std::max(1, (int)CpuAffinity::available_cpus().size() / nr_workers);
+    }
+    this->worker_threads = threads;
+
+    for(int i=0; i<nr_workers; i++) {
+        if(!this->worker_cpus[i].isEmpty()) {
+            qDebug() << "Worker " << i << " renders with " << threads << " thread(s) on core(s) "
+                     << CpuAffinity::to_string(this->worker_cpus[i]);
+        }
+    }
+}
+
+QProcess* ThreadRenderImage::build_process(const QString& cwd, RenderWorker* worker) {
+    return this->build_blender_process(cwd, {"manifest.json", "atompack.bin", cwd + "/image.png"},
+                                       this->workers.indexOf(worker));
+}
+
+/**
+ * @brief Build a resident Blender process that receives its jobs over stdin
+ */
+QProcess* ThreadRenderImage::build_session_process(int slot) {
+    // the folder is removed by the worker when the session ends
+    QString cwd = this->staging->create_job_dir();
+
+    return this->build_blender_process(cwd, {"--session"}, slot);
+}
+
+/**
+ * @brief Blender process with the thread budget and the cores of a worker slot
+ */
+QProcess* ThreadRenderImage::build_blender_process(const QString& cwd, const QStringList& script_arguments, int slot) {
+    QStringList arguments = {"-b", this->staging->get_template_path(),
+                             "-t", QString::number(this->worker_threads),
+                             "--python-exit-code", "1",
+                             "-P", this->staging->get_script_path(), "--"};
+    arguments << script_arguments;
+
+    QVector<int> cpus = this->worker_cpus.value(slot);
+    QProcess* blender_process = new PinnedProcess(cpus);
     blender_process->setProgram(this->executable);
     blender_process->setArguments(arguments);
     blender_process->setProcessChannelMode(QProcess::SeparateChannels);
     blender_process->setWorkingDirectory(cwd);
 
+    // the device is chosen once per process, hence it is not part of the manifest
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("SLABRENDER_DEVICE", this->parameters.value("render_device", "auto").toString().toLower());
+    blender_process->setProcessEnvironment(environment);
+
     return blender_process;
 }
 
-QString ThreadRenderImage::copy_template_files(const QString& contcarfile) {
-    QTemporaryDir dir;
-    dir.setAutoRemove(false); // do not immediately remove
-    if(dir.isValid()) {
-        // write Blender axes template file
-        QFile blenderfile(":/assets/blender/axes_template.blend");
-        if(!blenderfile.open(QIODevice::ReadOnly)) {
-            throw std::runtime_error("Could not open blender file from assets.");
+/**
+ * @brief Create a job folder for a band, holding the manifest and the atompack of its job
+ * @param atompackpath  atompack in the folder of the job
+ *
+ * The Blender assets are not copied; Blender reads them from the staging area.
+ */
+QString ThreadRenderImage::prepare_job_dir(const QString& atompackpath, int jobid, int tile) {
+    auto start = std::chrono::steady_clock::now();
+    QString cwd = this->staging->create_job_dir();
+
+    // link atompack.bin
+    if(!StagingArea::link_or_copy(atompackpath, cwd + "/atompack.bin")) {
+        QDir(cwd).removeRecursively();
+        throw std::runtime_error("Could not stage " + atompackpath.toStdString());
+    }
+
+    // write JSON manifest file
+    this->build_manifest_file(cwd + "/manifest.json", jobid, tile);
+    this->add_timing(jobid, "staging", start);
+
+    return cwd;
+}
+
+/**
+ * @brief Write the atompack of a structure file
+ *
+ * Files holding several structures are rendered as a still of the final
+ * structure. With the animation parameter, the scene is built from the first
+ * structure instead and the atompack is extended with a frames section
+ * holding the atomic positions of every frame. The topology (atoms and bonds)
+ * and the unit cell are fixed.
+ *
+ * Throws when the file holds no structure, when the number of atoms changes
+ * between frames or when the atompack cannot be written; the job then fails.
+ *
+ * @param path      structure file
+ * @param storepath atompack to write, in the folder of the job
+ * @return number of animation frames stored in the atompack, zero for a still image
+ */
+int ThreadRenderImage::create_atompack(const QString& path, const QString& storepath, int jobid) {
+    qDebug() << "Converting CONTCAR to atompack.bin for " << path;
+
+    auto start = std::chrono::steady_clock::now();
+    auto structures = sl.load_file(path);
+    if(structures.empty()) {
+        throw std::runtime_error("No structures found in " + path.toStdString());
+    }
+    this->add_timing(jobid, "parse", start);
+
+    // a still image shows the final structure, e.g. the result of a relaxation
+    QVector<int> frames = this->get_frame_indices(structures.size());
+    if(frames.isEmpty()) {
+        structures.erase(structures.begin(), structures.end() - 1);
+    }
+
+    start = std::chrono::steady_clock::now();
+    auto structure = structures.front();
+    structure->update();
+    this->add_timing(jobid, "update", start);
+
+    start = std::chrono::steady_clock::now();
+
+    // writing results to file
+    qDebug() << "Storing " << storepath;
+    if(this->parameters.value("atompack_version", 2).toInt() == 1) {
+        this->write_atompack_v1(storepath, structures, frames);
+    } else {
+        this->write_atompack_v2(storepath, structures, frames);
+    }
+    if(!frames.isEmpty()) {
+        qDebug() << "Stored " << frames.size() << " animation frames";
+    }
+
+    this->add_timing(jobid, "atompack", start);
+
+    return frames.size();
+}
+
+/**
+ * @brief Write a version 1 atompack: interleaved records, read by older scripts
+ */
+void ThreadRenderImage::write_atompack_v1(const QString& storepath, const std::vector<std::shared_ptr<Structure>>& structures,
+                                          const QVector<int>& frames) const {
+    const auto& structure = structures.front();
+
+    // the atompack is replaced in a single step, as job folders of running
+    // jobs may hold a hardlink to the previous one
+    QSaveFile out(storepath);
+    if(!out.open(QIODevice::WriteOnly)) {
+        throw std::runtime_error("Could not write " + storepath.toStdString());
+    }
+
+    // write unit cell
+    MatrixUnitcell mat = structure->get_unitcell();
+    for(unsigned int i=0; i<3; i++) {
+        for(unsigned int j=0; j<3; j++) {
+            double val = mat(i,j);
+            out.write((char*)&val, sizeof(double));
+        }
+    }
+
+    // write atoms
+    uint32_t nr_atoms = structure->get_nr_atoms();
+    out.write((char*)&nr_atoms, sizeof(uint32_t));
+    for(const auto& atom : structure->get_atoms()) {
+        const uint8_t atnr = atom.atnr;
+        out.write((char*)&atnr, sizeof(uint8_t));
+        out.write((char*)&atom.x, sizeof(double));
+        out.write((char*)&atom.y, sizeof(double));
+        out.write((char*)&atom.z, sizeof(double));
+    }
+
+    // write bonds
+    const uint32_t nr_bonds = structure->get_bonds().size();
+    out.write((char*)&nr_bonds, sizeof(uint32_t));
+    for(const auto& bond : structure->get_bonds()) {
+        const uint8_t atnr1 = bond.atom1.atnr;
+        out.write((char*)&atnr1, sizeof(uint8_t));                  // atom 1
+        const uint8_t atnr2 = bond.atom2.atnr;
+        out.write((char*)&atnr2, sizeof(uint8_t));                  // atom 2
+        out.write((char*)&bond.atom_id_1, sizeof(uint16_t));
+        out.write((char*)&bond.atom_id_2, sizeof(uint16_t));
+        out.write((char*)&bond.axis[0], sizeof(double) * 3);        // axis
+        out.write((char*)&bond.angle, sizeof(double));              // angle
+        out.write((char*)&bond.length, sizeof(double));             // length
+    }
+
+    // write expansion atoms
+    uint32_t nr_expansion_atoms = structure->get_expansion_atoms().size();
+    out.write((char*)&nr_expansion_atoms, sizeof(uint32_t));
+    for(const auto& atom : structure->get_expansion_atoms()) {
+        const uint8_t atnr = atom.atnr;
+        out.write((char*)&atnr, sizeof(uint8_t));
+        out.write((char*)&atom.x, sizeof(double));
+        out.write((char*)&atom.y, sizeof(double));
+        out.write((char*)&atom.z, sizeof(double));
+    }
+
+    // write bonds
+    const uint32_t nr_expansion_bonds = structure->get_expansion_bonds().size();
+    out.write((char*)&nr_expansion_bonds, sizeof(uint32_t));
+    for(const auto& bond : structure->get_expansion_bonds()) {
+        const uint8_t atnr1 = bond.atom1.atnr;
+        out.write((char*)&atnr1, sizeof(uint8_t));                  // atom 1
+        const uint8_t atnr2 = bond.atom2.atnr;
+        out.write((char*)&atnr2, sizeof(uint8_t));                  // atom 2
+        out.write((char*)&bond.atom_id_1, sizeof(uint16_t));
+        out.write((char*)&bond.atom_id_2, sizeof(uint16_t));
+        out.write((char*)&bond.axis[0], sizeof(double) * 3);        // axis
+        out.write((char*)&bond.angle, sizeof(double));              // angle
+        out.write((char*)&bond.length, sizeof(double));             // length
+    }
+
+    // write frames
+    if(!frames.isEmpty()) {
+        const uint32_t nr_frames_out = frames.size();
+        out.write((char*)&nr_frames_out, sizeof(uint32_t));
+        for(int idx : frames) {
+            const auto& frame = structures[idx];
+            if(frame->get_nr_atoms() != structure->get_nr_atoms()) {
+                throw std::runtime_error("Number of atoms changes between frames of " + storepath.toStdString());
+            }
+
+            for(const auto& atom : frame->get_atoms()) {
+                out.write((char*)&atom.x, sizeof(double));
+                out.write((char*)&atom.y, sizeof(double));
+                out.write((char*)&atom.z, sizeof(double));
+            }
+        }
+    }
+
+    if(!out.commit()) {
+        throw std::runtime_error("Could not write " + storepath.toStdString());
+    }
+}
+
+/**
+ * @brief Write a version 2 atompack: aligned columns per quantity (see AtomPackWriter)
+ */
+void ThreadRenderImage::write_atompack_v2(const QString& storepath, const std::vector<std::shared_ptr<Structure>>& structures,
+                                          const QVector<int>& frames) const {
+    const auto& structure = structures.front();
+    AtomPackWriter writer;
+
+    std::vector<double> cell(9);
+    MatrixUnitcell mat = structure->get_unitcell();
+    for(unsigned int i=0; i<3; i++) {
+        for(unsigned int j=0; j<3; j++) {
+            cell[i*3+j] = mat(i,j);
         }
-        blenderfile.copy(dir.path() + "/axes_template.blend");
+    }
+    writer.add_column("cell", cell, 3);
 
-        // copy atompack.bin
-        QString atompackpath = QFileInfo(contcarfile).absoluteDir().path() + "/atompack.bin";
-        QFile atompackfile(atompackpath);
-        if(atompackfile.open(QIODevice::ReadOnly)) {
-            atompackfile.copy(dir.path() + "/atompack.bin");
+    // atoms and bonds of the unit cell, followed by those of the periodic images
+    for(bool expansion : {false, true}) {
+        const auto& atoms = expansion ? structure->get_expansion_atoms() : structure->get_atoms();
+        std::vector<uint8_t> elements;
+        std::vector<double> positions;
+        std::vector<double> radii;
+        std::vector<uint8_t> colors;
+        elements.reserve(atoms.size());
+        positions.reserve(atoms.size() * 3);
+        radii.reserve(atoms.size());
+        colors.reserve(atoms.size() * 3);
+        for(size_t i=0; i<atoms.size(); i++) {
+            const auto& atom = atoms[i];
+            elements.push_back(atom.atnr);
+            positions.insert(positions.end(), {atom.x, atom.y, atom.z});
+
+            // custom directives are resolved here rather than per atom in Blender
+            radii.push_back(this->atom_style.get_radius(atom.atnr, i));
+            AtomStyle::Color color = this->atom_style.get_color(atom.atnr, i);
+            colors.insert(colors.end(), color.begin(), color.end());
         }
+        writer.add_column(expansion ? "expansion_atom.element" : "atom.element", elements);
+        writer.add_column(expansion ? "expansion_atom.position" : "atom.position", positions, 3);
+        writer.add_column(expansion ? "expansion_atom.radius" : "atom.radius", radii);
+        writer.add_column(expansion ? "expansion_atom.color" : "atom.color", colors, 3);
 
-        // write Python file containing Blender instructions
-        QFile pythonfile(":/assets/blender/render_image.py");
-        if(!pythonfile.open(QIODevice::ReadOnly)) {
-            throw std::runtime_error("Could not open Python file from assets.");
+        const auto& bonds = expansion ? structure->get_expansion_bonds() : structure->get_bonds();
+        std::vector<uint8_t> bond_elements;
+        std::vector<uint32_t> bond_atoms;
+        std::vector<double> axes, angles, lengths;
+        for(const auto& bond : bonds) {
+            bond_elements.insert(bond_elements.end(), {(uint8_t)bond.atom1.atnr, (uint8_t)bond.atom2.atnr});
+            bond_atoms.insert(bond_atoms.end(), {bond.atom_id_1, bond.atom_id_2});
+            axes.insert(axes.end(), {bond.axis[0], bond.axis[1], bond.axis[2]});
+            angles.push_back(bond.angle);
+            lengths.push_back(bond.length);
         }
-        pythonfile.copy(dir.path() + "/render_image.py");
+        writer.add_column(expansion ? "expansion_bond.element" : "bond.element", bond_elements, 2);
+        writer.add_column(expansion ? "expansion_bond.atom_id" : "bond.atom_id", bond_atoms, 2);
+        writer.add_column(expansion ? "expansion_bond.axis" : "bond.axis", axes, 3);
+        writer.add_column(expansion ? "expansion_bond.angle" : "bond.angle", angles);
+        writer.add_column(expansion ? "expansion_bond.length" : "bond.length", lengths);
+    }
 
-        // copy atoms.json file
-        QFile atomsjson(":/assets/configuration/atoms.json");
-        if(!atomsjson.open(QIODevice::ReadOnly)) {
-            throw std::runtime_error("Could not open blender file from assets.");
+    // animation frames: atomic positions per frame
+    if(!frames.isEmpty()) {
+        std::vector<double> frame_positions;
+        frame_positions.reserve(frames.size() * structure->get_nr_atoms() * 3);
+        for(int idx : frames) {
+            const auto& frame = structures[idx];
+            if(frame->get_nr_atoms() != structure->get_nr_atoms()) {
+                throw std::runtime_error("Number of atoms changes between frames of " + storepath.toStdString());
+            }
+            for(const auto& atom : frame->get_atoms()) {
+                frame_positions.insert(frame_positions.end(), {atom.x, atom.y, atom.z});
+            }
         }
-        atomsjson.copy(dir.path() + "/atoms.json");
+        writer.add_column("frame.position", frame_positions, std::max<uint32_t>(1, structure->get_nr_atoms() * 3));
+    }
 
-        // write JSON manifest file
-        this->build_manifest_file(dir.path() + "/manifest.json");
-    } else {
-        throw std::runtime_error("Invalid path");
+    writer.write(storepath);
+}
+
+/**
+ * @brief Add the duration of a phase to the timings of a job
+ */
+void ThreadRenderImage::add_timing(int jobid, const QString& phase, const std::chrono::time_point<std::chrono::steady_clock>& start) {
+    if(jobid < 0) {
+        return;
     }
 
-    return QDir::cleanPath(dir.path());
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    this->job_timings[jobid][phase] += elapsed_seconds.count();
 }
 
-void ThreadRenderImage::create_atompack(const QString& path) {
-    qDebug() << "Converting CONTCAR to atompack.bin for " << path;
-    try {
-        auto structure = sl.load_file(path).back();
-        structure->update();
+/**
+ * @brief Seconds spent per phase of a job as a JSON object
+ */
+QJsonObject ThreadRenderImage::get_timings_json(int id) const {
+    QJsonObject timings;
+    for(auto it = this->job_timings[id].begin(); it != this->job_timings[id].end(); ++it) {
+        timings[it.key()] = it.value();
+    }
+
+    return timings;
+}
+
+/**
+ * @brief Phases of a job in the order in which they occur
+ *
+ * parse, update, atompack and staging are measured before Blender is
+ * launched; startup, scene_build and render are reported by the worker and
+ * summed over the bands of a split job; output is the time spent publishing.
+ */
+const QStringList& ThreadRenderImage::get_timing_phases() {
+    static const QStringList phases = {"parse", "update", "atompack", "staging",
+                                       "startup", "scene_build", "render", "output"};
+    return phases;
+}
 
-        // ToDo: Convert to Qt based file handling routines
-
-        // writing results to file
-        auto storepath = QFileInfo(path).absoluteDir().path() + "/atompack.bin";
-        qDebug() << "Storing " << storepath;
-        std::ofstream out(storepath.toStdString(), std::ios::out | std::ios::binary);
-
-        // write unit cell
-        MatrixUnitcell mat = structure->get_unitcell();
-        for(unsigned int i=0; i<3; i++) {
-            for(unsigned int j=0; j<3; j++) {
-                double val = mat(i,j);
-                out.write((char*)&val, sizeof(double));
-            }
-        }
-
-        // write atoms
-        uint32_t nr_atoms = structure->get_nr_atoms();
-        out.write((char*)&nr_atoms, sizeof(uint32_t));
-        for(const auto& atom : structure->get_atoms()) {
-            const uint8_t atnr = atom.atnr;
-            out.write((char*)&atnr, sizeof(uint8_t));
-            out.write((char*)&atom.x, sizeof(double));
-            out.write((char*)&atom.y, sizeof(double));
-            out.write((char*)&atom.z, sizeof(double));
-        }
-
-        // write bonds
-        const uint32_t nr_bonds = structure->get_bonds().size();
-        out.write((char*)&nr_bonds, sizeof(uint32_t));
-        for(const auto& bond : structure->get_bonds()) {
-            const uint8_t atnr1 = bond.atom1.atnr;
-            out.write((char*)&atnr1, sizeof(uint8_t));                  // atom 1
-            const uint8_t atnr2 = bond.atom2.atnr;
-            out.write((char*)&atnr2, sizeof(uint8_t));                  // atom 2
-            out.write((char*)&bond.atom_id_1, sizeof(uint16_t));
-            out.write((char*)&bond.atom_id_2, sizeof(uint16_t));
-            out.write((char*)&bond.axis[0], sizeof(double) * 3);        // axis
-            out.write((char*)&bond.angle, sizeof(double));              // angle
-            out.write((char*)&bond.length, sizeof(double));             // length
-        }
-
-        // write expansion atoms
-        uint32_t nr_expansion_atoms = structure->get_expansion_atoms().size();
-        out.write((char*)&nr_expansion_atoms, sizeof(uint32_t));
-        for(const auto& atom : structure->get_expansion_atoms()) {
-            const uint8_t atnr = atom.atnr;
-            out.write((char*)&atnr, sizeof(uint8_t));
-            out.write((char*)&atom.x, sizeof(double));
-            out.write((char*)&atom.y, sizeof(double));
-            out.write((char*)&atom.z, sizeof(double));
-        }
-
-        // write bonds
-        const uint32_t nr_expansion_bonds = structure->get_expansion_bonds().size();
-        out.write((char*)&nr_expansion_bonds, sizeof(uint32_t));
-        for(const auto& bond : structure->get_expansion_bonds()) {
-            const uint8_t atnr1 = bond.atom1.atnr;
-            out.write((char*)&atnr1, sizeof(uint8_t));                  // atom 1
-            const uint8_t atnr2 = bond.atom2.atnr;
-            out.write((char*)&atnr2, sizeof(uint8_t));                  // atom 2
-            out.write((char*)&bond.atom_id_1, sizeof(uint16_t));
-            out.write((char*)&bond.atom_id_2, sizeof(uint16_t));
-            out.write((char*)&bond.axis[0], sizeof(double) * 3);        // axis
-            out.write((char*)&bond.angle, sizeof(double));              // angle
-            out.write((char*)&bond.length, sizeof(double));             // length
-        }
-
-        out.close();
-    }  catch (const std::exception& e) {
-        qCritical() << "Error encountered: " << e.what();
-    }
-}
-
-void ThreadRenderImage::build_manifest_file(const QString& path) {
+/**
+ * @brief Write the timings of all jobs to a CSV file or, for other extensions, a JSON file
+ */
+void ThreadRenderImage::export_timings(const QString& filename) const {
+    bool csv = QFileInfo(filename).suffix().toLower() == "csv";
+
+    QByteArray contents;
+    QJsonArray jobs;
+    if(csv) {
+        contents += "file," + get_timing_phases().join(",").toUtf8() + ",process_time\n";
+    }
+    for(int i=0; i<this->files.count(); i++) {
+        const QMap<QString, double>& timings = this->job_timings[i];
+        if(csv) {
+            QStringList fields = {"\"" + QString(this->files[i]).replace("\"", "\"\"") + "\""};
+            for(const QString& phase : get_timing_phases()) {
+                fields << QString::number(timings.value(phase), 'f', 4);
+            }
+            fields << QString::number(this->process_times.value(i), 'f', 4);
+            contents += fields.join(",").toUtf8() + "\n";
+        } else {
+            QJsonObject job = this->get_timings_json(i);
+            job["file"] = this->files[i];
+            job["process_time"] = this->process_times.value(i);
+            jobs.append(job);
+        }
+    }
+    if(!csv) {
+        contents = QJsonDocument(jobs).toJson();
+    }
+
+    QSaveFile file(filename);
+    if(!file.open(QIODevice::WriteOnly) || file.write(contents) < 0 || !file.commit()) {
+        throw std::runtime_error("Could not write timings to " + filename.toStdString());
+    }
+}
+
+void ThreadRenderImage::build_manifest_file(const QString& path, int jobid, int tile) {
     QFile outfile(path);
     if(outfile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream stream(&outfile);
+        outfile.write(this->build_manifest(jobid, tile));
+        outfile.close();
+    }
+}
+
+/**
+ * @brief Noise reduction settings of a job and the predicted time of a plain render
+ *
+ * The reference time is the cost model's prediction for the job at
+ * reference_samples without adaptive sampling or denoising, such that the
+ * saving can be weighed against the image quality. Empty when neither
+ * adaptive sampling nor denoising is enabled.
+ */
+QJsonObject ThreadRenderImage::get_noise_reduction(int jobid) const {
+    QJsonObject result;
+    bool adaptive = this->parameters.value("adaptive_sampling", false).toBool();
+    bool denoise = this->parameters.value("denoise", false).toBool();
+    if(!adaptive && !denoise) {
+        return result;
+    }
+
+    result["adaptive_sampling"] = adaptive;
+    if(adaptive) {
+        result["noise_threshold"] = this->parameters.value("noise_threshold", 0.01).toDouble();
+    }
+    result["denoise"] = denoise;
+
+    int reference_samples = this->parameters.value("reference_samples", 512).toInt();
+    if(this->cost_model && this->job_features.contains(jobid) && reference_samples > this->get_samples(jobid)) {
+        JobFeatures features = this->job_features[jobid];
+        features.samples = reference_samples;
+        result["reference_samples"] = reference_samples;
+        result["reference_time"] = this->cost_model->predict(features);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Build the contents of the JSON manifest file
+ * @param tile  band of a split job to render, -1 for the whole image
+ */
+QByteArray ThreadRenderImage::build_manifest(int jobid, int tile) {
+    QByteArray manifest;
+    {
+        QTextStream stream(&manifest, QIODevice::WriteOnly);
 
         stream << "{" << "\n";
 
         QStringList string_parameters = {"bondmat", "atmat", "camera_direction"};
-        QStringList bool_parameters = {"expansion", "hide_axes", "show_unitcell"};
-        QStringList int_parameters = {"resolution_x", "resolution_y", "tile_x", "tile_y", "samples", "nsubdiv"};
+        QStringList bool_parameters = {"expansion", "hide_axes", "show_unitcell", "adaptive_sampling", "denoise", "instancing", "animation"};
+        QStringList int_parameters = {"resolution_x", "resolution_y", "tile_x", "tile_y", "samples", "nsubdiv", "frame_step"};
 
         try {
             // whether to have regular ortho scale or custom
@@ -264,7 +1947,39 @@ void ThreadRenderImage::build_manifest_file(const QString& path) {
             }
 
             for(const QString& str : int_parameters) {
-                stream << "\"" << str << "\": " << this->parameters[str].toInt() << ",\n";
+                int value = this->parameters[str].toInt();
+                if(str == "samples") {
+                    value = this->job_samples.value(jobid) > 0 ? this->job_samples[jobid] : value;  // possibly reduced to fit a time budget
+                }
+                if(this->drafting) {
+                    if(str == "resolution_x" || str == "resolution_y") {
+                        value = std::max(16, (int)std::round(value * this->parameters.value("draft_scale", 0.25).toDouble()));
+                    } else if(str == "samples") {
+                        value = std::min(value, this->parameters.value("draft_samples", 16).toInt());
+                    }
+                }
+                stream << "\"" << str << "\": " << value << ",\n";
+            }
+
+            if(this->parameters.value("adaptive_sampling", false).toBool()) {
+                stream << "\"noise_threshold\": " << this->parameters.value("noise_threshold", 0.01).toDouble() << ",\n";
+            }
+
+            stream << "\"lod_segment_pixels\": " << this->parameters.value("lod_segment_pixels", 2.0).toDouble() << ",\n";
+
+            if(this->job_time_limits.contains(jobid) && !this->drafting) {
+                stream << "\"time_limit\": " << this->job_time_limits[jobid] << ",\n";
+            }
+
+            if(!this->views.isEmpty()) {
+                stream << "\"views\": " << QJsonDocument(this->views).toJson(QJsonDocument::Compact) << ",\n";
+            }
+
+            // bands are rendered with the same seed, such that their noise matches that of a full render
+            if(tile >= 0 && this->tile_sets.contains(jobid)) {
+                auto rows = get_band(this->parameters["resolution_y"].toInt(), this->tile_sets[jobid].nr_tiles, tile, TILE_OVERLAP);
+                stream << "\"border\": [0, " << rows.first << ", " << this->parameters["resolution_x"].toInt() << ", " << rows.second << "],\n";
+                stream << "\"seed\": 0,\n";
             }
         }  catch (const std::exception& e) {
             qCritical() << tr("Error encountered in parsing parameters: ") + tr(e.what());
@@ -275,7 +1990,7 @@ void ThreadRenderImage::build_manifest_file(const QString& path) {
         stream << "\"generator\": \"SlabRender\"\n";
 
         stream << "}" << "\n";
-
-        outfile.close();
     }
+
+    return manifest;
 }
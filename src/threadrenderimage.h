@@ -28,11 +28,52 @@
 #include <QProcess>
 #include <QTextStream>
 #include <QMap>
+#include <QTimer>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QCryptographicHash>
+#include <QImage>
+#include <QPair>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QEventLoop>
 
 #include <fstream>
 #include <chrono>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <cstring>
 
 #include "structure_loader.h"
+#include "atompack.h"
+#include "atom_style.h"
+#include "render_worker.h"
+#include "render_cache.h"
+#include "render_journal.h"
+#include "cost_model.h"
+#include "staging_area.h"
+#include "job_lease.h"
+#include "cpu_affinity.h"
+#include "output_stage.h"
+
+/**
+ * @brief State of a job whose image is rendered in horizontal bands by several workers
+ */
+struct TileSet {
+    int nr_tiles = 0;
+    int remaining = 0;              // tiles that have not finished yet
+    bool failed = false;
+    QStringList dirs;               // job folder per tile
+    QVector<double> progress;       // rendered fraction per tile
+    QVector<double> eta;            // remaining render time in seconds per tile
+    double process_time = 0.0;      // summed over the tiles
+    int samples = -1;               // fewest samples rendered by a band, -1 when unknown
+    QString source_dir;             // job folder holding the atompack the bands link to
+};
 
 class ThreadRenderImage : public QThread
 {
@@ -49,9 +90,75 @@ private:
     QMap<QString, QVariant> parameters;
 
     QVector<double> process_times;
+    QVector<QMap<QString, double>> job_timings;     // seconds per phase per job id, see get_timing_phases
 
     int single_job_id = -1;
 
+    QList<int> pending;                 // jobs still waiting for a worker
+
+    QVector<RenderWorker*> workers;     // pool of Blender workers
+
+    QVector<QVector<int>> worker_cpus;  // cores each worker's Blender is pinned to
+    int worker_threads = 1;             // render threads per Blender process
+
+    QList<QPair<int, int>> pending_tiles;   // tiles (job id, tile) waiting for a worker
+
+    QHash<int, TileSet> tile_sets;      // jobs that are split over multiple workers
+
+    static constexpr int TILE_OVERLAP = 16;     // rows rendered beyond both edges of a band
+
+    bool cancelled = false;
+
+    bool drafting = false;              // whether the draft pass is being rendered
+
+    QSet<int> rejected;                 // jobs excluded from the final pass, accessed from the GUI thread
+    mutable QMutex mutex_rejected;
+
+    QDateTime reject_file_modified;     // modification time of the reject file when last read
+
+    QString data_folder;
+
+    QString output_folder;                  // empty: store images next to the structure files
+
+    QString base_folder;                    // folder layout below this folder is mirrored in the output folder
+
+    QJsonArray views;                       // camera directions and orientations rendered per structure
+
+    std::unique_ptr<RenderCache> cache;     // only present when caching is enabled
+
+    std::unique_ptr<RenderJournal> journal; // only present when a data folder is set
+
+    QByteArray asset_hash;                  // hash over the Blender assets
+
+    std::unique_ptr<StagingArea> staging;   // shared copy of the Blender assets
+
+    QHash<int, QString> input_hashes;       // hash over the inputs per job id
+
+    std::unique_ptr<CostModel> cost_model;  // predicts render times from earlier runs
+
+    std::unique_ptr<OutputStage> output_stage;  // publishes the rendered images in the background
+
+    QHash<int, JobFeatures> job_features;   // cost determining properties per job id
+
+    QVector<int> job_samples;               // effective number of samples per job id, zero when not rendered
+
+    QVector<int> job_frames;                // number of animation frames per job id, zero for a still image
+    AtomStyle atom_style;                   // radius and color per atom, resolved from the custom JSON
+
+    QHash<int, double> job_time_limits;     // Cycles time limit in seconds per budgeted job id
+
+    std::chrono::time_point<std::chrono::steady_clock> queue_start;
+
+    bool distributed = false;               // whether jobs are shared with other instances
+
+    QList<int> deferred;                    // jobs currently claimed by other instances
+
+    std::unique_ptr<LeaseKeeper> leases;    // claims of this instance, when sharing jobs
+
+    QHash<int, std::shared_ptr<JobLease>> claims;   // lease per job id, kept between attempts to claim the job
+
+    QEventLoop* event_loop = nullptr;       // loop running the passes, only set within run()
+
 public:
     ThreadRenderImage();
 
@@ -59,24 +166,92 @@ public:
         this->files = _files;
         this->output.resize(this->files.count());
         this->process_times.resize(this->files.count());
+        this->job_timings = QVector<QMap<QString, double>>(this->files.count());
+        this->job_samples.fill(0, this->files.count());
+        this->job_frames.fill(0, this->files.count());
     }
 
     inline void set_single_job_id(int _job_id) {
         this->single_job_id = _job_id;
     }
 
+    /**
+     * @brief Exclude a job from the final pass; can be called from any thread
+     */
+    void reject(int jobid);
+
+    /**
+     * @brief Whether a job is excluded from the final pass
+     */
+    bool is_rejected(int jobid) const;
+
+    /**
+     * @brief Set the folder holding the render journal
+     */
+    inline void set_data_folder(const QString& _data_folder) {
+        this->data_folder = _data_folder;
+    }
+
+    /**
+     * @brief Store rendered images in a separate folder, mirroring the layout below base folder
+     */
+    inline void set_output_folder(const QString& _output_folder, const QString& _base_folder) {
+        this->output_folder = _output_folder;
+        this->base_folder = _base_folder;
+    }
+
     inline void set_executable(const QString& _executable) {
         this->executable = _executable;
     }
 
+    inline int get_nr_jobs() const {
+        return this->files.count();
+    }
+
     inline const QStringList& get_output(int id) const {
         return this->output[id];
     }
 
+    /**
+     * @brief Number of samples a job has been rendered with
+     */
+    inline int get_samples(int id) const {
+        return this->job_samples[id] > 0 ? this->job_samples[id] : this->parameters.value("samples").toInt();
+    }
+
+    /**
+     * @brief Number of animation frames of a job, zero for a still image
+     */
+    inline int get_nr_frames(int id) const {
+        return this->job_frames[id];
+    }
+
     inline double get_process_time(int id) const {
         return this->process_times[id];
     }
 
+    /**
+     * @brief Seconds spent per phase of a job, see get_timing_phases
+     */
+    inline const QMap<QString, double>& get_timings(int id) const {
+        return this->job_timings[id];
+    }
+
+    /**
+     * @brief Seconds spent per phase of a job as a JSON object
+     */
+    QJsonObject get_timings_json(int id) const;
+
+    /**
+     * @brief Phases of a job in the order in which they occur
+     */
+    static const QStringList& get_timing_phases();
+
+    /**
+     * @brief Write the timings of all jobs to a CSV file or, for other extensions, a JSON file
+     */
+    void export_timings(const QString& filename) const;
+
     inline const QString& get_file(int id) const {
         return this->files[id];
     }
@@ -85,24 +260,350 @@ public:
         this->parameters = _parameters;
     }
 
+    /**
+     * @brief Default render parameters, identical to the defaults of the settings panel
+     */
+    static QMap<QString, QVariant> default_parameters();
+
+    /**
+     * @brief Location of the rendered image of a job
+     * @param name  name of the view or frame; empty for a single image
+     * @param draft whether to refer to the image of the draft pass
+     */
+    QString get_image_path(int jobid, const QString& name = QString(), bool draft = false) const;
+
+    /**
+     * @brief Locations of all images of a job, one per view or animation frame
+     * @param draft whether to refer to the images of the draft pass
+     */
+    QStringList get_image_paths(int jobid, bool draft = false) const;
+
+    /**
+     * @brief Parse a list of views
+     *
+     * Views are given either as a list of objects holding a camera_direction
+     * and/or an object_euler (and optionally a name) or as a comma separated
+     * string in which every view reads "Z+", "30/0/90" or "X+:30/0/90".
+     *
+     * @return list of view objects, each with a name usable in a file name
+     */
+    static QJsonArray parse_views(const QVariant& views);
+
+    /**
+     * @brief First and last (exclusive) row of a band, counted from the top
+     * @param overlap   number of rows to extend the band with on both sides
+     */
+    static QPair<int, int> get_band(int height, int nr_tiles, int tile, int overlap = 0);
+
+    /**
+     * @brief Assemble bands rendered with an overlap into a single image
+     * @param bands     bands from top to bottom, each including its overlap (see get_band)
+     * @return the image, null when a band is missing or has an unexpected size
+     */
+    static QImage stitch_bands(const QVector<QImage>& bands, int width, int height, int overlap);
+
     void run();
 
 private:
-    QProcess* build_process(const QString& executable);
+    /**
+     * @brief Launch the next pending job on a worker or stop the event loop
+     *        when the queue is exhausted and all workers are idle
+     */
+    void dispatch(RenderWorker* worker);
+
+    /**
+     * @brief Collect output of a finished job and copy its image back
+     */
+    void finalize_job(RenderWorker* worker, int jobid, bool success);
+
+    /**
+     * @brief Publish the images of a finished job and record its outcome
+     * @param cwd           job folder holding the rendered images, removed afterwards
+     * @param process_time  render time in seconds
+     * @param samples       samples rendered according to Cycles, -1 when unknown
+     */
+    void complete_job(int jobid, bool success, const QString& cwd, double process_time, int samples = -1);
+
+    /**
+     * @brief Report a job whose images have been published by the output stage
+     * @param draft     whether the images belong to the draft pass
+     */
+    void publish_done(int jobid, bool draft, const OutputResult& result);
+
+    /**
+     * @brief Key of an image in the render cache
+     */
+    QString get_cache_key(int jobid, const QString& name) const;
+
+    /**
+     * @brief Maximum duration of a job in seconds before its worker is stopped
+     */
+    int get_timeout(int jobid) const;
+
+    /**
+     * @brief Number of bands the image of a job is split into
+     *
+     * Still images are split according to the split_tiles parameter, but only
+     * when fewer jobs are pending than there are workers; otherwise the workers
+     * are kept busy by the queue itself and splitting only adds overhead.
+     */
+    int get_nr_tiles(int jobid) const;
+
+    /**
+     * @brief Queue the tiles of a job and hand them to the idle workers
+     * @param source_dir    job folder holding the atompack, removed once all tiles are done
+     */
+    void split_job(RenderWorker* worker, int jobid, int nr_tiles, const QString& source_dir);
+
+    /**
+     * @brief Render a tile of a split job on a worker
+     * @return whether the tile has been launched
+     */
+    bool launch_tile(RenderWorker* worker, int jobid, int tile);
+
+    /**
+     * @brief Collect output of a finished tile
+     */
+    void finalize_tile(RenderWorker* worker, int jobid, bool success);
+
+    /**
+     * @brief Register a finished tile and complete the job once all tiles are in
+     */
+    void complete_tile(int jobid, int tile, bool success, double process_time, int samples = -1);
+
+    /**
+     * @brief Assemble the bands of a split job into the image of the first tile
+     * @return whether all bands are present and the image has been written
+     */
+    bool stitch_tiles(int jobid);
+
+    /**
+     * @brief Report the combined progress of the tiles of a split job
+     */
+    void update_tile_progress(int jobid, int tile, double fraction, double eta);
+
+    /**
+     * @brief Kill all live Blender processes and drop the pending jobs
+     */
+    void cancel_workers();
+
+    bool has_busy_workers() const;
+
+    /**
+     * @brief Whether no worker is rendering, no job is deferred and all images are published
+     */
+    bool is_idle() const;
+
+    /**
+     * @brief Whether no job is pending and the queue is idle
+     */
+    bool is_exhausted() const;
+
+    /**
+     * @brief Stop the event loop once the queue is exhausted
+     */
+    void quit_if_idle();
+
+    /**
+     * @brief Names of the images produced per job; a single empty name without views
+     */
+    QStringList get_view_names() const;
+
+    /**
+     * @brief Names of the images produced by a job, i.e. its views or animation frames
+     */
+    QStringList get_output_names(int jobid) const;
+
+    /**
+     * @brief Indices of the structures in a trajectory that are rendered as animation frames
+     *
+     * Only with the animation parameter set; every frame_step-th structure is used
+     * and the final structure is always included. Single structures yield no
+     * frames and are rendered as a still.
+     */
+    QVector<int> get_frame_indices(size_t nr_structures) const;
+
+    static QString get_image_filename(const QString& view, bool draft = false, const QString& extension = "png");
+
+    /**
+     * @brief Extension of the published images, see the output_format parameter
+     */
+    QString get_image_extension() const;
+
+    /**
+     * @brief Mark the jobs listed in the reject file as rejected
+     *
+     * Every line of the file holds the path to a structure file or its folder.
+     * The file is only read again when it has been modified.
+     */
+    void read_reject_file();
+
+    /**
+     * @brief Whether all images of a job are present
+     */
+    bool has_images(int jobid) const;
 
-    QString copy_template_files(const QString& contcarfile);
+    /**
+     * @brief Determine the properties of a job that drive its render time
+     */
+    JobFeatures compute_features(const QString& file);
 
-    void create_atompack(const QString& contcarpath);
+    /**
+     * @brief Sort the pending jobs according to the queue_order parameter
+     */
+    void order_queue();
 
-    void build_manifest_file(const QString& path);
+    /**
+     * @brief Estimate the remaining time of the queue by simulating the worker pool
+     */
+    double estimate_queue_time() const;
+
+    /**
+     * @brief Choose the number of samples of a job such that it finishes within its time budget
+     */
+    void apply_time_budget(int jobid);
+
+    /**
+     * @brief Noise reduction settings of a job and the predicted time of a plain render
+     */
+    QJsonObject get_noise_reduction(int jobid) const;
+
+    /**
+     * @brief Hash over the Blender assets, the atompack and the manifest of a job
+     */
+    QString compute_input_hash(int jobid, const QString& atompackpath);
+
+    /**
+     * @brief Restore the image of a job from the render cache
+     * @return whether the job was found in the cache
+     */
+    bool restore_from_cache(int jobid);
+
+    /**
+     * @brief Report a job whose image is available without rendering
+     */
+    void complete_without_render(int jobid, const QString& message, double process_time);
+
+    /**
+     * @brief Hash identifying a job across instances: assets, settings and structure file
+     */
+    QString get_job_key(int jobid);
+
+    /**
+     * @brief Report a job that another instance has completed
+     * @return whether the job is completed
+     */
+    bool complete_if_done_elsewhere(int jobid);
+
+    /**
+     * @brief Give up the claim on a job
+     * @param done  whether to mark the job as completed for the other instances
+     */
+    void release_lease(int jobid, bool done);
+
+    /**
+     * @brief Stop rendering a job whose lease has been reclaimed by another instance
+     */
+    void abandon_job(int jobid);
+
+    /**
+     * @brief Retry the jobs claimed by other instances
+     */
+    void retry_deferred();
+
+    /**
+     * @brief Divide the CPU threads over the workers and pin them to disjoint cores
+     */
+    void assign_cpus(int nr_workers);
+
+    QProcess* build_process(const QString& cwd, RenderWorker* worker);
+
+    /**
+     * @brief Build a resident Blender process that receives its jobs over stdin
+     */
+    QProcess* build_session_process(int slot);
+
+    /**
+     * @brief Blender process with the thread budget and the cores of a worker slot
+     */
+    QProcess* build_blender_process(const QString& cwd, const QStringList& script_arguments, int slot);
+
+    /**
+     * @brief Create a job folder for a band, holding the manifest and the atompack of its job
+     */
+    QString prepare_job_dir(const QString& atompackpath, int jobid, int tile);
+
+    /**
+     * @brief Write the atompack of a structure file
+     * @return number of animation frames stored in the atompack, zero for a still image
+     */
+    int create_atompack(const QString& contcarpath, const QString& storepath, int jobid = -1);
+
+    /**
+     * @brief Write a version 1 atompack: interleaved records, read by older scripts
+     */
+    void write_atompack_v1(const QString& storepath, const std::vector<std::shared_ptr<Structure>>& structures,
+                           const QVector<int>& frames) const;
+
+    /**
+     * @brief Write a version 2 atompack: aligned columns per quantity (see AtomPackWriter)
+     */
+    void write_atompack_v2(const QString& storepath, const std::vector<std::shared_ptr<Structure>>& structures,
+                           const QVector<int>& frames) const;
+
+    /**
+     * @brief Add the duration of a phase to the timings of a job
+     */
+    void add_timing(int jobid, const QString& phase, const std::chrono::time_point<std::chrono::steady_clock>& start);
+
+    void build_manifest_file(const QString& path, int jobid, int tile = -1);
+
+    /**
+     * @brief Build the contents of the JSON manifest file
+     * @param tile  band of a split job to render, -1 for the whole image
+     */
+    QByteArray build_manifest(int jobid = -1, int tile = -1);
 
 signals:
-    void signal_job_done(int jobid);
+    /**
+     * @brief A job has been completed
+     * @param samples   number of samples the job has been rendered with
+     * @param frames    number of animation frames, zero for a still image
+     *
+     * The counts are passed along as receivers in another thread must not
+     * read them from the queue while it is running.
+     */
+    void signal_job_done(int jobid, int samples, int frames);
 
     void signal_job_start(int jobid);
 
+    void signal_job_failed(int jobid);
+
+    /**
+     * @brief The draft of a job has been rendered; its final render follows later
+     */
+    void signal_draft_done(int jobid);
+
+    /**
+     * @brief A rejected job has been dropped from the final pass
+     */
+    void signal_job_rejected(int jobid);
+
+    /**
+     * @brief Render progress of a running job
+     * @param jobid     job id
+     * @param fraction  fraction of the render that is done
+     * @param eta       estimated remaining time in seconds
+     */
+    void signal_job_progress(int jobid, double fraction, double eta);
+
     void signal_queue_done();
 
+    /**
+     * @brief Estimated remaining time of the queue in seconds
+     */
+    void signal_queue_eta(double seconds);
+
     void signal_queue_cancelled();
 };
 
@@ -220,11 +220,11 @@ void AnaglyphWidget::paint_model() {
             const Atom& atom = this->structure->get_atom(i);
             this->model = base;
             this->model.translate(QVector3D(atom.x, atom.y, atom.z));
-            this->model.scale(AtomSettings::get().get_atom_radius_from_elnr(atom.atnr));
+            this->model.scale(this->atom_style.get_radius(atom.atnr, i));
             this->mvp = this->projection * this->view * this->model;
             model_shader->set_uniform("mvp", this->mvp);
             model_shader->set_uniform("model", this->model);
-            QVector3D col = AtomSettings::get().get_atom_color_from_elnr(atom.atnr);
+            QVector3D col = this->atom_style.get_color_vector(atom.atnr, i);
 
             if(this->selected_atom >= 0 && this->selected_atom == i) {
                 col = (col + QVector3D(1.0, 1.0, 1.0)) / 2.0;
@@ -242,8 +242,8 @@ void AnaglyphWidget::paint_model() {
             this->model.translate(QVector3D(bond.atom1.x, bond.atom1.y, bond.atom1.z));
             this->model.rotate(bond.angle / M_PI * 180.f, QVector3D(bond.axis[0], bond.axis[1], bond.axis[2]));
 
-            float r1 = AtomSettings::get().get_atom_radius_from_elnr(bond.atom1.atnr);
-            float r2 = AtomSettings::get().get_atom_radius_from_elnr(bond.atom2.atnr);
+            float r1 = this->atom_style.get_radius(bond.atom1.atnr, bond.atom_id_1);
+            float r2 = this->atom_style.get_radius(bond.atom2.atnr, bond.atom_id_2);
             float r = std::min(r1,r2) / 2.0f;
 
             this->model.scale(QVector3D(r, r, bond.length));
@@ -640,7 +640,7 @@ int AnaglyphWidget::get_atom_raycast(const QVector3D& ray_origin, const QVector3
         auto p = atom.get_pos();
         QVector3D pos = base.map(QVector3D(p[0], p[1], p[2]));
 
-        float radius = AtomSettings::get().get_atom_radius_from_elnr(atom.atnr);
+        float radius = this->atom_style.get_radius(atom.atnr, i);
         float b = QVector3D::dotProduct(ray_vector, ray_origin - pos);
         float c = QVector3D::dotProduct(ray_origin - pos, ray_origin - pos) - (radius * radius);
 
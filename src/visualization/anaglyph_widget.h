@@ -60,6 +60,7 @@
 #include "primitivebuilder.h"
 #include "../structure_loader.h"
 #include "../atom_settings.h"
+#include "../atom_style.h"
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
 
@@ -120,6 +121,9 @@ private:
 
     int selected_atom = -1;
 
+    // radius and color of the atoms, including the custom directives
+    AtomStyle atom_style;
+
 public:
     AnaglyphWidget(QWidget *parent = 0);
 
@@ -133,6 +137,10 @@ public:
         return this->structure;
     }
 
+    inline void set_atom_style(const AtomStyle& _atom_style) {
+        this->atom_style = _atom_style;
+    }
+
     inline QVector3D get_euler_angles() const {
         return QQuaternion::fromRotationMatrix((this->arcball_rotation*this->rotation_matrix).normalMatrix()).toEulerAngles();
     }
@@ -0,0 +1,74 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+
+#include "atom_style.h"
+
+class TestAtomStyle : public QObject {
+    Q_OBJECT
+
+private slots:
+    void defaults();
+    void last_match_wins();
+    void skip_invalid_directives();
+};
+
+void TestAtomStyle::defaults() {
+    AtomStyle style;
+    QCOMPARE(style.get_radius(8, 0), AtomSettings::get().get_atom_radius_from_elnr(8));
+
+    const QVector3D& color = AtomSettings::get().get_atom_color_from_elnr(8);
+    AtomStyle::Color expected = {(uint8_t)std::lround(color[0] * 255.f),
+                                 (uint8_t)std::lround(color[1] * 255.f),
+                                 (uint8_t)std::lround(color[2] * 255.f)};
+    QVERIFY(style.get_color(8, 0) == expected);
+}
+
+/**
+ * @brief Directives use 1-based atom indices, 0/0 selects all atoms of the element
+ */
+void TestAtomStyle::last_match_wins() {
+    AtomStyle style("\"atom_radii\": [\"O/0/0/0.5\", \"O/2/3/0.8\"],"
+                    "\"atom_colors\": [\"O/2/2/#00ff00\", \"O/0/0/#ff0000\", \"Fe/1/1/0000ff\"],");
+
+    QCOMPARE(style.get_radius(8, 0), 0.5f);
+    QCOMPARE(style.get_radius(8, 1), 0.8f);
+    QCOMPARE(style.get_radius(8, 2), 0.8f);
+    QCOMPARE(style.get_radius(8, 3), 0.5f);
+    QCOMPARE(style.get_radius(26, 1), AtomSettings::get().get_atom_radius_from_elnr(26));
+
+    // the catch-all directive follows the one for atom 2 and overrides it
+    QVERIFY(style.get_color(8, 1) == (AtomStyle::Color{255, 0, 0}));
+    QVERIFY(style.get_color(26, 0) == (AtomStyle::Color{0, 0, 255}));
+    QVERIFY(style.get_color(26, 1) != (AtomStyle::Color{0, 0, 255}));
+}
+
+void TestAtomStyle::skip_invalid_directives() {
+    AtomStyle style("\"atom_radii\": [\"O/0/0/0.5\", \"O/0/0/-1\", \"Xx/0/0/0.7\", \"O/a/0/0.9\"]");
+    QCOMPARE(style.get_radius(8, 0), 0.5f);
+
+    // invalid JSON leaves the defaults in place
+    AtomStyle invalid("\"atom_radii\": [");
+    QCOMPARE(invalid.get_radius(8, 0), AtomSettings::get().get_atom_radius_from_elnr(8));
+}
+
+QTEST_GUILESS_MAIN(TestAtomStyle)
+#include "test_atom_style.moc"
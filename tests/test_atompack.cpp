@@ -0,0 +1,105 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "atompack.h"
+
+class TestAtomPack : public QObject {
+    Q_OBJECT
+
+private slots:
+    void round_trip();
+    void reject_invalid_column();
+};
+
+/**
+ * @brief Read back the header, the 48-byte column table and the aligned columns
+ */
+void TestAtomPack::round_trip() {
+    std::vector<double> positions = {0.0, 0.5, 1.0, 1.5, 2.0, 2.5};
+    std::vector<uint8_t> colors = {255, 0, 0, 0, 255, 0};
+    std::vector<uint32_t> elements = {8, 1, 1};
+
+    AtomPackWriter writer;
+    writer.add_column("position", positions, 3);
+    writer.add_column("color", colors, 3);
+    writer.add_column("element", elements);
+
+    QTemporaryDir dir;
+    QString path = dir.path() + "/atoms.atompack";
+    writer.write(path);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+
+    QCOMPARE(data.left(8), QByteArray("ATOMPACK"));
+    uint32_t version = 0;
+    uint32_t nr_columns = 0;
+    memcpy(&version, data.constData() + 8, sizeof(uint32_t));
+    memcpy(&nr_columns, data.constData() + 12, sizeof(uint32_t));
+    QCOMPARE(version, AtomPackWriter::VERSION);
+    QCOMPARE(nr_columns, 3u);
+
+    const QByteArray order = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "<" : ">";
+    const QList<QByteArray> names = {"position", "color", "element"};
+    const QList<QByteArray> dtypes = {order + "f8", "|u1", order + "u4"};
+    const QList<uint32_t> widths = {3, 3, 1};
+    const QList<uint64_t> nr_rows = {2, 2, 3};
+    const QList<QByteArray> contents = {
+        QByteArray(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(double)),
+        QByteArray(reinterpret_cast<const char*>(colors.data()), colors.size()),
+        QByteArray(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(uint32_t)),
+    };
+
+    uint64_t end = 16 + nr_columns * 48;
+    for(int i=0; i<(int)nr_columns; i++) {
+        const char* entry = data.constData() + 16 + i * 48;
+        uint32_t width = 0;
+        uint64_t offset = 0;
+        uint64_t rows = 0;
+        memcpy(&width, entry + 28, sizeof(uint32_t));
+        memcpy(&offset, entry + 32, sizeof(uint64_t));
+        memcpy(&rows, entry + 40, sizeof(uint64_t));
+
+        QCOMPARE(QByteArray(entry, 24), names[i].leftJustified(24, '\0'));
+        QCOMPARE(QByteArray(entry + 24, 4), dtypes[i].leftJustified(4, '\0'));
+        QCOMPARE(width, widths[i]);
+        QCOMPARE(rows, nr_rows[i]);
+        QCOMPARE(offset % AtomPackWriter::ALIGNMENT, (uint64_t)0);
+        QVERIFY(offset >= end);
+        QCOMPARE(data.mid(offset, contents[i].size()), contents[i]);
+        end = offset + contents[i].size();
+    }
+    QCOMPARE((uint64_t)data.size(), end);
+}
+
+void TestAtomPack::reject_invalid_column() {
+    AtomPackWriter writer;
+    std::vector<double> values = {1.0, 2.0, 3.0, 4.0};
+    QVERIFY_EXCEPTION_THROWN(writer.add_column("position", values, 3), std::logic_error);
+    QVERIFY_EXCEPTION_THROWN(writer.add_column("position", values, 0), std::logic_error);
+    QVERIFY_EXCEPTION_THROWN(writer.add_column("a_column_name_beyond_24_chars", values), std::logic_error);
+}
+
+QTEST_GUILESS_MAIN(TestAtomPack)
+#include "test_atompack.moc"
@@ -0,0 +1,105 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+
+#include "threadrenderimage.h"
+
+class TestBands : public QObject {
+    Q_OBJECT
+
+private slots:
+    void band_offsets();
+    void stitch_overlapping_bands();
+    void stitch_missing_band();
+};
+
+/**
+ * @brief Bands cover every row exactly once; the overlap is clipped at the image edges
+ */
+void TestBands::band_offsets() {
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 0), qMakePair(0, 33));
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 1), qMakePair(33, 66));
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 2), qMakePair(66, 100));
+
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 0, 16), qMakePair(0, 49));
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 1, 16), qMakePair(17, 82));
+    QCOMPARE(ThreadRenderImage::get_band(100, 3, 2, 16), qMakePair(50, 100));
+
+    for(int nr_tiles : {1, 2, 7, 13}) {
+        int next = 0;
+        for(int t=0; t<nr_tiles; t++) {
+            auto band = ThreadRenderImage::get_band(1079, nr_tiles, t);
+            QCOMPARE(band.first, next);
+            next = band.second;
+        }
+        QCOMPARE(next, 1079);
+    }
+}
+
+void TestBands::stitch_overlapping_bands() {
+    const int width = 7;
+    const int height = 50;
+    const int overlap = 4;
+    const int nr_tiles = 3;
+
+    QImage image(width, height, QImage::Format_ARGB32);
+    for(int y=0; y<height; y++) {
+        for(int x=0; x<width; x++) {
+            image.setPixel(x, y, qRgba(y * 5, x * 30, 128, 255 - y));
+        }
+    }
+
+    // the overlapping rows of the bands differ from the image and must be dropped
+    QVector<QImage> bands;
+    for(int t=0; t<nr_tiles; t++) {
+        auto rows = ThreadRenderImage::get_band(height, nr_tiles, t);
+        auto rendered = ThreadRenderImage::get_band(height, nr_tiles, t, overlap);
+        QImage band = image.copy(0, rendered.first, width, rendered.second - rendered.first);
+        for(int y=rendered.first; y<rendered.second; y++) {
+            if(y < rows.first || y >= rows.second) {
+                for(int x=0; x<width; x++) {
+                    band.setPixel(x, y - rendered.first, qRgba(0, 0, 0, 0));
+                }
+            }
+        }
+        bands << band;
+    }
+
+    QImage stitched = ThreadRenderImage::stitch_bands(bands, width, height, overlap);
+    QCOMPARE(stitched.size(), image.size());
+    QCOMPARE(stitched, image);
+}
+
+void TestBands::stitch_missing_band() {
+    QVector<QImage> bands;
+    bands << QImage(8, 10 + 2, QImage::Format_ARGB32) << QImage();
+    QVERIFY(ThreadRenderImage::stitch_bands(bands, 8, 20, 2).isNull());
+
+    // a band without its overlap
+    bands[1] = QImage(8, 10, QImage::Format_ARGB32);
+    QVERIFY(ThreadRenderImage::stitch_bands(bands, 8, 20, 2).isNull());
+
+    bands[1] = QImage(8, 10 + 2, QImage::Format_ARGB32);
+    QVERIFY(!ThreadRenderImage::stitch_bands(bands, 8, 20, 2).isNull());
+}
+
+QTEST_GUILESS_MAIN(TestBands)
+#include "test_bands.moc"
@@ -0,0 +1,123 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "cost_model.h"
+
+class TestCostModel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void predict_prior();
+    void fit_timings();
+    void minimum_prediction();
+    void save_and_load();
+
+private:
+    static JobFeatures build_features(double nr_atoms, double nr_bonds, double pixels, double samples);
+
+    /**
+     * @brief Render time following the model with known coefficients
+     */
+    static double get_render_time(const JobFeatures& features);
+};
+
+JobFeatures TestCostModel::build_features(double nr_atoms, double nr_bonds, double pixels, double samples) {
+    JobFeatures features;
+    features.nr_atoms = nr_atoms;
+    features.nr_bonds = nr_bonds;
+    features.pixels = pixels;
+    features.samples = samples;
+    return features;
+}
+
+double TestCostModel::get_render_time(const JobFeatures& features) {
+    double nr_objects = features.nr_atoms + features.nr_bonds;
+    double gigasamples = features.pixels * features.samples * 1e-9;
+    return 2.0 + 0.005 * nr_objects + 40.0 * gigasamples + 3.0 * gigasamples * std::log1p(nr_objects);
+}
+
+/**
+ * @brief Without timings the prior coefficients are used
+ */
+void TestCostModel::predict_prior() {
+    QTemporaryDir dir;
+    CostModel model(dir.path() + "/render_timings.json");
+    QCOMPARE(model.get_nr_samples(), (size_t)0);
+
+    JobFeatures features = build_features(80, 20, 1920 * 1080, 128);
+    double gigasamples = 1920.0 * 1080.0 * 128.0 * 1e-9;
+    double expected = 5.0 + 0.02 * 100 + 20.0 * gigasamples + 5.0 * gigasamples * std::log1p(100.0);
+    QVERIFY(std::abs(model.predict(features) - expected) < 1e-9 * expected);
+}
+
+void TestCostModel::fit_timings() {
+    QTemporaryDir dir;
+    CostModel model(dir.path() + "/render_timings.json");
+
+    for(double nr_atoms : {10.0, 100.0, 1000.0, 5000.0}) {
+        for(double pixels : {640.0 * 480.0, 1920.0 * 1080.0, 3840.0 * 2160.0}) {
+            for(double samples : {16.0, 128.0, 512.0}) {
+                JobFeatures features = build_features(nr_atoms, 2.0 * nr_atoms, pixels, samples);
+                model.add_sample(features, get_render_time(features));
+            }
+        }
+    }
+    QCOMPARE(model.get_nr_samples(), (size_t)36);
+
+    // a job that is not part of the history
+    JobFeatures features = build_features(2000, 3000, 2560 * 1440, 256);
+    double expected = get_render_time(features);
+    QVERIFY(std::abs(model.predict(features) - expected) < 0.05 * expected);
+}
+
+void TestCostModel::minimum_prediction() {
+    QTemporaryDir dir;
+    CostModel model(dir.path() + "/render_timings.json");
+
+    JobFeatures features = build_features(1, 0, 64 * 64, 1);
+    for(int i=0; i<100; i++) {
+        model.add_sample(features, 0.1);
+    }
+    QCOMPARE(model.predict(features), 1.0);
+}
+
+void TestCostModel::save_and_load() {
+    QTemporaryDir dir;
+    QString filename = dir.path() + "/history/render_timings.json";
+    JobFeatures features = build_features(500, 800, 1920 * 1080, 64);
+    double prediction = 0.0;
+    {
+        CostModel model(filename);
+        model.add_sample(features, 42.0);
+        model.add_sample(build_features(50, 60, 640 * 480, 32), 6.0);
+        model.save();
+        prediction = model.predict(features);
+    }
+
+    CostModel model(filename);
+    QCOMPARE(model.get_nr_samples(), (size_t)2);
+    QCOMPARE(model.predict(features), prediction);
+}
+
+QTEST_GUILESS_MAIN(TestCostModel)
+#include "test_cost_model.moc"
@@ -0,0 +1,78 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+
+#include "cpu_affinity.h"
+
+class TestCpuAffinity : public QObject {
+    Q_OBJECT
+
+private slots:
+    void partition();
+    void partition_evenly();
+    void partition_oversubscribed();
+    void to_string();
+};
+
+void TestCpuAffinity::partition() {
+    QVector<int> cpus = {0, 1, 2, 3, 4, 5, 8, 9};
+    auto sets = CpuAffinity::partition(cpus, 3, 2);
+    QCOMPARE(sets.size(), 3);
+    QCOMPARE(sets[0], QVector<int>({0, 1}));
+    QCOMPARE(sets[1], QVector<int>({2, 3}));
+    QCOMPARE(sets[2], QVector<int>({4, 5}));
+}
+
+void TestCpuAffinity::partition_evenly() {
+    QVector<int> cpus = {0, 1, 2, 3, 4, 5, 6};
+    auto sets = CpuAffinity::partition(cpus, 2, 0);
+    QCOMPARE(sets.size(), 2);
+    QCOMPARE(sets[0], QVector<int>({0, 1, 2}));
+    QCOMPARE(sets[1], QVector<int>({3, 4, 5}));
+
+    // the cores of this process are divided without overlap
+    QVector<int> available = CpuAffinity::available_cpus();
+    QVERIFY(!available.isEmpty());
+    auto own = CpuAffinity::partition(1, 0);
+    QCOMPARE(own.size(), 1);
+    QCOMPARE(own[0], available);
+}
+
+/**
+ * @brief Workers are not pinned when the cores cannot be divided
+ */
+void TestCpuAffinity::partition_oversubscribed() {
+    auto sets = CpuAffinity::partition({0, 1, 2, 3}, 3, 2);
+    QCOMPARE(sets.size(), 3);
+    for(const auto& set : sets) {
+        QVERIFY(set.isEmpty());
+    }
+}
+
+void TestCpuAffinity::to_string() {
+    QCOMPARE(CpuAffinity::to_string({0, 1, 2, 3, 8}), QString("0-3,8"));
+    QCOMPARE(CpuAffinity::to_string({1, 3, 4, 6, 7, 8}), QString("1,3-4,6-8"));
+    QCOMPARE(CpuAffinity::to_string({5}), QString("5"));
+    QCOMPARE(CpuAffinity::to_string({}), QString());
+}
+
+QTEST_GUILESS_MAIN(TestCpuAffinity)
+#include "test_cpu_affinity.moc"
@@ -0,0 +1,176 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "job_lease.h"
+
+class TestJobLease : public QObject {
+    Q_OBJECT
+
+private slots:
+    void acquire_exclusive();
+    void lease_per_file();
+    void heartbeat();
+    void reclaim_expired();
+    void keep_refreshed_lease();
+    void report_lost_lease();
+    void mark_done();
+};
+
+void TestJobLease::acquire_exclusive() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    {
+        JobLease lease(file, "host-a:1:aaaa", 60);
+        QVERIFY(lease.acquire());
+        QCOMPARE(JobLease::get_owner(file), QString("host-a:1:aaaa"));
+        QCOMPARE(JobLease::get_lease_path(file), dir.path() + "/.POSCAR.slabrender.lease");
+
+        JobLease other(file, "host-b:2:bbbb", 60);
+        QVERIFY(!other.acquire());
+        QCOMPARE(JobLease::get_owner(file), QString("host-a:1:aaaa"));
+    }
+
+    // the lease is released on destruction
+    QVERIFY(JobLease::get_owner(file).isEmpty());
+    QVERIFY(!QFile::exists(JobLease::get_lease_path(file)));
+}
+
+/**
+ * @brief Structures sharing a folder are claimed independently
+ */
+void TestJobLease::lease_per_file() {
+    QTemporaryDir dir;
+    JobLease lease_a(dir.path() + "/POSCAR_a", "host-a:1:aaaa", 60);
+    JobLease lease_b(dir.path() + "/POSCAR_b", "host-b:2:bbbb", 60);
+    QVERIFY(lease_a.acquire());
+    QVERIFY(lease_b.acquire());
+    QCOMPARE(JobLease::get_owner(dir.path() + "/POSCAR_b"), QString("host-b:2:bbbb"));
+}
+
+void TestJobLease::heartbeat() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    JobLease lease(file, "host-a:1:aaaa", 60);
+    QVERIFY(!lease.heartbeat());
+    QVERIFY(lease.acquire());
+
+    QFile lease_file(JobLease::get_lease_path(file));
+    QVERIFY(lease_file.open(QIODevice::ReadOnly));
+    QByteArray before = lease_file.readAll();
+    lease_file.close();
+    QTest::qWait(20);
+
+    // every heartbeat changes the contents, which is what other instances observe
+    QVERIFY(lease.heartbeat());
+    QVERIFY(lease_file.open(QIODevice::ReadOnly));
+    QByteArray after = lease_file.readAll();
+    lease_file.close();
+
+    QVERIFY(after != before);
+    QCOMPARE(QJsonDocument::fromJson(after).object()["owner"].toString(), QString("host-a:1:aaaa"));
+}
+
+/**
+ * @brief An instance that stopped sending heartbeats loses its lease once
+ *        another instance has observed it unchanged for the timeout
+ */
+void TestJobLease::reclaim_expired() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    JobLease stale(file, "host-a:1:aaaa", 60);
+    QVERIFY(stale.acquire());
+
+    // the first observation never expires, whatever the timestamps in the lease
+    JobLease lease(file, "host-b:2:bbbb", 1);
+    QVERIFY(!lease.acquire());
+    QTest::qWait(1100);
+    QVERIFY(lease.acquire());
+    QCOMPARE(JobLease::get_owner(file), QString("host-b:2:bbbb"));
+
+    // the previous owner notices the takeover and leaves the new lease alone
+    QVERIFY(!stale.heartbeat());
+    stale.release();
+    QCOMPARE(JobLease::get_owner(file), QString("host-b:2:bbbb"));
+    QVERIFY(lease.heartbeat());
+
+    // no stale copies are left behind
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files | QDir::Hidden).size(), 1);
+}
+
+void TestJobLease::keep_refreshed_lease() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    JobLease owner(file, "host-a:1:aaaa", 60);
+    QVERIFY(owner.acquire());
+
+    JobLease lease(file, "host-b:2:bbbb", 1);
+    QVERIFY(!lease.acquire());
+    for(int i=0; i<3; i++) {
+        QTest::qWait(600);
+        QVERIFY(owner.heartbeat());
+        QVERIFY(!lease.acquire());
+    }
+    QCOMPARE(JobLease::get_owner(file), QString("host-a:1:aaaa"));
+}
+
+/**
+ * @brief The keeper stops sending heartbeats for a lease that has been taken over
+ */
+void TestJobLease::report_lost_lease() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    auto lease = std::make_shared<JobLease>(file, "host-a:1:aaaa", 60);
+    QVERIFY(lease->acquire());
+
+    LeaseKeeper keeper(10);
+    QSignalSpy spy(&keeper, &LeaseKeeper::signal_lease_lost);
+    keeper.insert(7, lease);
+
+    QSaveFile takeover(JobLease::get_lease_path(file));
+    QVERIFY(takeover.open(QIODevice::WriteOnly));
+    takeover.write("{\"owner\": \"host-b:2:bbbb\"}");
+    QVERIFY(takeover.commit());
+    keeper.start();
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toInt(), 7);
+    QVERIFY(!keeper.take(7));
+    keeper.stop();
+    QCOMPARE(JobLease::get_owner(file), QString("host-b:2:bbbb"));
+}
+
+void TestJobLease::mark_done() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/POSCAR";
+    QVERIFY(JobLease::read_done(file).isEmpty());
+
+    JobLease::mark_done(file, {{"input_hash", "abc"}, {"process_time", 3.5}});
+    QJsonObject done = JobLease::read_done(file);
+    QCOMPARE(done["input_hash"].toString(), QString("abc"));
+    QCOMPARE(done["process_time"].toDouble(), 3.5);
+    QCOMPARE(done["owner"].toString(), JobLease::instance_id());
+    QVERIFY(QFile::exists(dir.path() + "/.POSCAR.slabrender.done"));
+}
+
+QTEST_GUILESS_MAIN(TestJobLease)
+#include "test_job_lease.moc"
@@ -0,0 +1,130 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "render_cache.h"
+
+class TestRenderCache : public QObject {
+    Q_OBJECT
+
+private slots:
+    void keep_extension();
+    void evict_partial_entries();
+    void replace_on_fetch();
+
+private:
+    static void write(const QString& path, const QByteArray& data);
+    static QByteArray read(const QString& path);
+    static void touch(const QString& path, int secs);
+};
+
+/**
+ * @brief Entries are stored under the extension of the image, such that the
+ *        formats of a job do not overwrite each other
+ */
+void TestRenderCache::keep_extension() {
+    QTemporaryDir dir;
+    RenderCache cache(1024 * 1024, dir.path() + "/cache");
+    write(dir.path() + "/image.jpg", "jpg");
+    write(dir.path() + "/image.png", "png");
+    cache.store("abc", dir.path() + "/image.jpg");
+    cache.store("abc", dir.path() + "/image.png");
+
+    QVERIFY(QFile::exists(dir.path() + "/cache/abc.jpg"));
+    QVERIFY(QFile::exists(dir.path() + "/cache/abc.png"));
+    QVERIFY(!QFile::exists(dir.path() + "/cache/abc.jpg.png"));
+
+    QDir().mkpath(dir.path() + "/out");
+    QVERIFY(cache.fetch("abc", dir.path() + "/out/restored.jpg"));
+    QCOMPARE(read(dir.path() + "/out/restored.jpg"), QByteArray("jpg"));
+    QVERIFY(!cache.fetch("abc", dir.path() + "/out/restored.bmp"));
+    QVERIFY(!cache.fetch("def", dir.path() + "/out/restored.png"));
+}
+
+/**
+ * @brief Partial entries of an interrupted store are removed by the eviction
+ */
+void TestRenderCache::evict_partial_entries() {
+    QTemporaryDir dir;
+    RenderCache cache(1024 * 1024, dir.path() + "/cache");
+
+    QString stale = dir.path() + "/cache/old.png.part";
+    write(stale, "partial");
+    touch(stale, -86400);
+    QString recent = dir.path() + "/cache/new.png.part";
+    write(recent, "partial");
+    touch(recent, -600);
+
+    write(dir.path() + "/image.png", "png");
+    cache.store("abc", dir.path() + "/image.png");
+    touch(dir.path() + "/cache/abc.png", -600);
+
+    QVERIFY(!QFile::exists(stale));
+    QVERIFY(QFile::exists(recent));
+    QVERIFY(QFile::exists(dir.path() + "/cache/abc.png"));
+
+    // partial entries count towards the size of the cache
+    RenderCache small(3, dir.path() + "/cache");
+    small.store("def", dir.path() + "/image.png");
+    QCOMPARE(QDir(dir.path() + "/cache").entryList(QDir::Files), QStringList{"def.png"});
+}
+
+/**
+ * @brief A restored image replaces an existing one in a single step
+ */
+void TestRenderCache::replace_on_fetch() {
+    QTemporaryDir dir;
+    RenderCache cache(1024 * 1024, dir.path() + "/cache");
+    write(dir.path() + "/image.png", "new");
+    cache.store("abc", dir.path() + "/image.png");
+
+    write(dir.path() + "/out/image.png", "old image");
+    QVERIFY(cache.fetch("abc", dir.path() + "/out/image.png"));
+    QCOMPARE(read(dir.path() + "/out/image.png"), QByteArray("new"));
+    QCOMPARE(QDir(dir.path() + "/out").entryList(QDir::Files), QStringList{"image.png"});
+
+    // a failed fetch leaves the existing image alone
+    QVERIFY(!cache.fetch("def", dir.path() + "/out/image.png"));
+    QCOMPARE(read(dir.path() + "/out/image.png"), QByteArray("new"));
+}
+
+void TestRenderCache::write(const QString& path, const QByteArray& data) {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(data);
+}
+
+QByteArray TestRenderCache::read(const QString& path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void TestRenderCache::touch(const QString& path, int secs) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(secs), QFileDevice::FileModificationTime));
+}
+
+QTEST_GUILESS_MAIN(TestRenderCache)
+#include "test_render_cache.moc"
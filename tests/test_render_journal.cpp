@@ -0,0 +1,147 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "render_journal.h"
+
+class TestRenderJournal : public QObject {
+    Q_OBJECT
+
+private slots:
+    void replay_last_state();
+    void resume_skips_done_job();
+    void resume_renders_changed_job();
+    void skip_truncated_record();
+    void compact_on_open();
+};
+
+void TestRenderJournal::replay_last_state() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/a/POSCAR";
+    {
+        RenderJournal journal(dir.path());
+        journal.record(file, "queued");
+        journal.record(file, "running", {{"input_hash", "abc"}});
+    }
+
+    RenderJournal journal(dir.path());
+    QCOMPARE(journal.get_state(file)["state"].toString(), QString("running"));
+    QCOMPARE(journal.get_state(file)["file"].toString(), QString("a/POSCAR"));
+    QVERIFY(journal.get_done(file).isEmpty());
+    QVERIFY(!journal.is_done(file, "abc"));
+}
+
+/**
+ * @brief A run queues all its jobs before dispatching them, which must not hide
+ *        the completions of the previous run
+ */
+void TestRenderJournal::resume_skips_done_job() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/a/POSCAR";
+    {
+        RenderJournal journal(dir.path());
+        journal.record(file, "queued");
+        journal.record(file, "running", {{"input_hash", "abc"}});
+        journal.record(file, "done", {{"input_hash", "abc"}, {"process_time", 12.5}});
+    }
+
+    // two resumed runs that were interrupted before the job was dispatched
+    for(int run=0; run<2; run++) {
+        RenderJournal journal(dir.path());
+        journal.record(file, "queued");
+        QCOMPARE(journal.get_state(file)["state"].toString(), QString("queued"));
+        QVERIFY(journal.is_done(file, "abc"));
+        QCOMPARE(journal.get_done(file)["process_time"].toDouble(), 12.5);
+    }
+}
+
+void TestRenderJournal::resume_renders_changed_job() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/a/POSCAR";
+    {
+        RenderJournal journal(dir.path());
+        journal.record(file, "done", {{"input_hash", "abc"}});
+    }
+
+    RenderJournal journal(dir.path());
+    journal.record(file, "queued");
+    QVERIFY(!journal.is_done(file, "def"));
+    QVERIFY(!journal.is_done(dir.path() + "/b/POSCAR", "abc"));
+}
+
+void TestRenderJournal::skip_truncated_record() {
+    QTemporaryDir dir;
+    QString file = dir.path() + "/a/POSCAR";
+    {
+        RenderJournal journal(dir.path());
+        journal.record(file, "done", {{"input_hash", "abc"}});
+    }
+
+    // a crash while writing leaves a partial line
+    QFile journal_file(dir.path() + "/" + RenderJournal::FILENAME);
+    QVERIFY(journal_file.open(QIODevice::Append));
+    journal_file.write("{\"file\": \"a/POSCAR\", \"sta");
+    journal_file.close();
+
+    {
+        RenderJournal journal(dir.path());
+        QVERIFY(journal.is_done(file, "abc"));
+        journal.record(file, "done", {{"input_hash", "def"}});
+    }
+
+    // the record following the partial line is intact
+    RenderJournal journal(dir.path());
+    QVERIFY(journal.is_done(file, "def"));
+}
+
+/**
+ * @brief Records superseded by later runs are dropped when the journal is opened
+ */
+void TestRenderJournal::compact_on_open() {
+    QTemporaryDir dir;
+    QString file_a = dir.path() + "/a/POSCAR";
+    QString file_b = dir.path() + "/b/POSCAR";
+    for(int run=0; run<3; run++) {
+        RenderJournal journal(dir.path());
+        journal.record(file_a, "queued");
+        journal.record(file_a, "running", {{"input_hash", "abc"}});
+        journal.record(file_a, "done", {{"input_hash", "abc"}});
+        journal.record(file_b, "queued");
+        journal.record(file_b, "failed", {{"error", "crashed"}});
+        journal.record(file_a, "queued");
+    }
+
+    RenderJournal journal(dir.path());
+    QCOMPARE(journal.get_state(file_a)["state"].toString(), QString("queued"));
+    QVERIFY(journal.is_done(file_a, "abc"));
+    QCOMPARE(journal.get_state(file_b)["error"].toString(), QString("crashed"));
+    QVERIFY(journal.get_done(file_b).isEmpty());
+
+    // the done and last record of a, the last record of b
+    QFile journal_file(dir.path() + "/" + RenderJournal::FILENAME);
+    QVERIFY(journal_file.open(QIODevice::ReadOnly));
+    QCOMPARE(journal_file.readAll().count('\n'), 3);
+}
+
+QTEST_GUILESS_MAIN(TestRenderJournal)
+#include "test_render_journal.moc"
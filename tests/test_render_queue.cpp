@@ -0,0 +1,98 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QStandardPaths>
+
+#include "threadrenderimage.h"
+
+class TestRenderQueue : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fail_mismatched_trajectory();
+
+private:
+    /**
+     * @brief Write a Gaussian log file holding one geometry per entry of nr_atoms
+     */
+    static void write_trajectory(const QString& filename, const QVector<int>& nr_atoms);
+};
+
+void TestRenderQueue::initTestCase() {
+    // keep the staging area and the render timings out of the user's folders
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+/**
+ * @brief A trajectory whose frames differ in their number of atoms cannot be
+ *        animated; the job fails instead of rendering a stale atompack
+ */
+void TestRenderQueue::fail_mismatched_trajectory() {
+    QTemporaryDir dir;
+    QDir().mkpath(dir.path() + "/a");
+    QString file = dir.path() + "/a/trajectory.log";
+    write_trajectory(file, {2, 3});
+
+    ThreadRenderImage queue;
+    auto parameters = ThreadRenderImage::default_parameters();
+    parameters["animation"] = true;
+    queue.set_parameters(parameters);
+    queue.set_files({file});
+    queue.set_data_folder(dir.path());
+    queue.set_executable(dir.path() + "/blender");
+
+    QSignalSpy spy_failed(&queue, &ThreadRenderImage::signal_job_failed);
+    QSignalSpy spy_done(&queue, &ThreadRenderImage::signal_job_done);
+    QSignalSpy spy_queue_done(&queue, &ThreadRenderImage::signal_queue_done);
+    queue.start();
+    QVERIFY(queue.wait(60000));
+
+    QCOMPARE(spy_queue_done.count(), 1);
+    QCOMPARE(spy_done.count(), 0);
+    QCOMPARE(spy_failed.count(), 1);
+    QCOMPARE(spy_failed.at(0).at(0).toInt(), 0);
+    QVERIFY(!QFile::exists(dir.path() + "/a/atompack.bin"));
+
+    RenderJournal journal(dir.path());
+    QCOMPARE(journal.get_state(file)["state"].toString(), QString("failed"));
+}
+
+void TestRenderQueue::write_trajectory(const QString& filename, const QVector<int>& nr_atoms) {
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QTextStream out(&file);
+    for(int n : nr_atoms) {
+        out << "                         Standard orientation:                         \n"
+            << " ---------------------------------------------------------------------\n"
+            << " Center     Atomic      Atomic             Coordinates (Angstroms)\n"
+            << " Number     Number       Type             X           Y           Z\n"
+            << " ---------------------------------------------------------------------\n";
+        for(int i=0; i<n; i++) {
+            out << QString("      %1          1           0        %2    0.000000    0.000000\n").arg(i + 1).arg(0.75 * i, 0, 'f', 6);
+        }
+        out << " ---------------------------------------------------------------------\n";
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRenderQueue)
+#include "test_render_queue.moc"
@@ -0,0 +1,96 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+
+#include "render_worker.h"
+
+class TestRenderWorker : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parse_progress_samples();
+    void parse_progress_tiles();
+    void parse_progress_none();
+    void parse_remaining();
+    void parse_sample();
+    void fail_on_exit_code();
+};
+
+void TestRenderWorker::parse_progress_samples() {
+    QCOMPARE(RenderWorker::parse_progress("Fra:1 Mem:84.20M (Peak 90.12M) | Time:00:03.21 | Remaining:00:10.45 | "
+                                          "Mem:12.00M, Peak:12.00M | Scene, ViewLayer | Sample 32/128"), 0.25);
+    QCOMPARE(RenderWorker::parse_progress("Sample 128/128"), 1.0);
+    QCOMPARE(RenderWorker::parse_progress("Sample 200/128"), 1.0);
+}
+
+/**
+ * @brief Older versions of Cycles report the tile next to the sample of that tile
+ */
+void TestRenderWorker::parse_progress_tiles() {
+    QCOMPARE(RenderWorker::parse_progress("Fra:1 Mem:84.20M | Time:00:03.21 | Remaining:00:10.45 | "
+                                          "Scene | RenderLayer | Path Tracing Tile 3/4, Sample 64/128"), 0.625);
+    QCOMPARE(RenderWorker::parse_progress("Fra:1 Mem:84.20M | Time:00:03.21 | Scene | RenderLayer | "
+                                          "Rendered 1/4 Tiles, Sample 32/128"), 0.0625);
+}
+
+void TestRenderWorker::parse_progress_none() {
+    QVERIFY(RenderWorker::parse_progress("Fra:1 Mem:84.20M | Time:00:00.51 | Synchronizing object | Atom") < 0.0);
+    QVERIFY(RenderWorker::parse_progress("Sample 0/0") < 0.0);
+    QVERIFY(RenderWorker::parse_progress(QString()) < 0.0);
+}
+
+void TestRenderWorker::parse_remaining() {
+    QCOMPARE(RenderWorker::parse_remaining("Fra:1 | Time:00:03.21 | Remaining:00:10.45 | Sample 32/128"), 10.45);
+    QCOMPARE(RenderWorker::parse_remaining("Fra:1 | Time:00:03.21 | Remaining:02:10.50 | Sample 32/128"), 130.5);
+    QCOMPARE(RenderWorker::parse_remaining("Fra:1 | Time:00:03.21 | Remaining:01:02:03.50 | Sample 32/128"), 3723.5);
+    QVERIFY(RenderWorker::parse_remaining("Fra:1 | Time:00:03.21 | Sample 1/128") < 0.0);
+}
+
+void TestRenderWorker::parse_sample() {
+    QCOMPARE(RenderWorker::parse_sample("Fra:1 | Remaining:00:10.45 | Sample 32/128"), 32);
+    QCOMPARE(RenderWorker::parse_sample("Path Tracing Tile 3/4, Sample 64/128"), 64);
+    QCOMPARE(RenderWorker::parse_sample("Fra:1 | Denoising"), -1);
+}
+
+/**
+ * @brief A process that exits normally with a non-zero code has failed
+ */
+void TestRenderWorker::fail_on_exit_code() {
+#ifndef Q_OS_UNIX
+    QSKIP("Requires a POSIX shell");
+#endif
+    for(int exit_code : {0, 3}) {
+        RenderWorker worker;
+        QSignalSpy spy(&worker, &RenderWorker::signal_job_finished);
+        QProcess* process = new QProcess();
+        process->setProgram("/bin/sh");
+        process->setArguments({"-c", QString("exit %1").arg(exit_code)});
+        worker.launch(5, process);
+
+        QTRY_COMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).toInt(), 5);
+        QCOMPARE(spy.at(0).at(1).toBool(), exit_code == 0);
+        QVERIFY(!worker.is_busy());
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRenderWorker)
+#include "test_render_worker.moc"
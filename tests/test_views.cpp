@@ -0,0 +1,72 @@
+/********************************************************************************
+ * This file is part of Saucepan                                                *
+ *                                                                              *
+ * Author: Ivo Filot <i.a.w.filot@tue.nl>                                       *
+ *                                                                              *
+ * This program is free software; you can redistribute it and/or                *
+ * modify it under the terms of the GNU Lesser General Public                   *
+ * License as published by the Free Software Foundation; either                 *
+ * version 3 of the License, or (at your option) any later version.             *
+ *                                                                              *
+ * This program is distributed in the hope that it will be useful,              *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU            *
+ * Lesser General Public License for more details.                              *
+ *                                                                              *
+ * You should have received a copy of the GNU Lesser General Public License     *
+ * along with this program; if not, write to the Free Software Foundation,      *
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.          *
+ ********************************************************************************/
+
+#include <QtTest>
+
+#include "threadrenderimage.h"
+
+class TestViews : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parse_view_string();
+    void parse_view_list();
+    void reject_invalid_view();
+};
+
+void TestViews::parse_view_string() {
+    QJsonArray views = ThreadRenderImage::parse_views("Z+, 30/0/90,x-:30/0/90");
+    QCOMPARE(views.size(), 3);
+
+    QCOMPARE(views[0].toObject()["name"].toString(), QString("Z+"));
+    QCOMPARE(views[0].toObject()["camera_direction"].toString(), QString("Z+"));
+    QVERIFY(!views[0].toObject().contains("object_euler"));
+
+    QCOMPARE(views[1].toObject()["name"].toString(), QString("30_0_90"));
+    QCOMPARE(views[1].toObject()["object_euler"].toString(), QString("30/0/90"));
+    QVERIFY(!views[1].toObject().contains("camera_direction"));
+
+    QCOMPARE(views[2].toObject()["name"].toString(), QString("X-_30_0_90"));
+    QCOMPARE(views[2].toObject()["camera_direction"].toString(), QString("X-"));
+
+    QVERIFY(ThreadRenderImage::parse_views(QString()).isEmpty());
+}
+
+void TestViews::parse_view_list() {
+    QVariantList list;
+    list << QVariantMap{{"camera_direction", "Y-"}, {"name", "side view"}};
+    list << QVariantMap{{"object_euler", "0/45/0"}};
+    list << QString("Z+");
+
+    QJsonArray views = ThreadRenderImage::parse_views(list);
+    QCOMPARE(views.size(), 3);
+    QCOMPARE(views[0].toObject()["name"].toString(), QString("side_view"));
+    QCOMPARE(views[1].toObject()["name"].toString(), QString("0_45_0"));
+    QCOMPARE(views[2].toObject()["name"].toString(), QString("Z+"));
+}
+
+void TestViews::reject_invalid_view() {
+    QVERIFY_EXCEPTION_THROWN(ThreadRenderImage::parse_views("Z+,W+"), std::runtime_error);
+    QVERIFY_EXCEPTION_THROWN(ThreadRenderImage::parse_views("30/0"), std::runtime_error);
+    QVERIFY_EXCEPTION_THROWN(ThreadRenderImage::parse_views(QVariantList{QVariantMap{}}), std::runtime_error);
+}
+
+QTEST_GUILESS_MAIN(TestViews)
+#include "test_views.moc"